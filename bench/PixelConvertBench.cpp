@@ -0,0 +1,184 @@
+/**
+ * Checks every SIMD pixel kernel against the scalar one and reports the
+ * throughput of each, counting the bytes read and written.
+ *
+ *   cmake -DXWIN_BUILD_BENCHMARKS=ON ... && ./xwin-pixel-bench
+ *
+ * Exits with 1 if any kernel differs from scalar.
+ */
+#include "CrossWindow/Common/PixelConvert.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace xwin::pixel;
+
+namespace
+{
+// 256 x 256 pixels give every colour value with every alpha value
+const size_t kCheckPixels = 256 * 256;
+
+// One 1080p frame
+const size_t kBenchPixels = 1920 * 1080;
+
+enum class Kernel
+{
+    Rgb565,
+    X2Rgb10,
+    Premultiply,
+    SwapRedBlue,
+    KernelMax
+};
+
+const char* kernelNames[] = {"rgb565", "x2rgb10", "premultiply",
+                             "swapRedBlue"};
+
+// Output bytes per pixel of each kernel
+const size_t kernelDstBytes[] = {2, 4, 4, 4};
+
+void run(const KernelSet& set, Kernel kernel, void* dst,
+         const uint32_t* src, size_t count)
+{
+    switch (kernel)
+    {
+    case Kernel::Rgb565:
+        set.rgb565(static_cast<uint16_t*>(dst), src, count);
+        break;
+    case Kernel::X2Rgb10:
+        set.x2rgb10(static_cast<uint32_t*>(dst), src, count);
+        break;
+    case Kernel::Premultiply:
+        set.premultiply(static_cast<uint32_t*>(dst), src, count);
+        break;
+    case Kernel::SwapRedBlue:
+        set.swapRedBlue(static_cast<uint32_t*>(dst), src, count);
+        break;
+    default:
+        break;
+    }
+}
+
+// Every (colour, alpha) pair in each channel, then random pixels
+std::vector<uint32_t> makeSource(size_t count)
+{
+    std::vector<uint32_t> src(count);
+    std::mt19937 random(1234);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (i < kCheckPixels)
+        {
+            uint32_t c = i & 0xff;
+            uint32_t a = (i >> 8) & 0xff;
+            src[i] = (a << 24) | (c << 16) | ((255 - c) << 8) | (c ^ 0x5a);
+        }
+        else
+        {
+            src[i] = static_cast<uint32_t>(random());
+        }
+    }
+    return src;
+}
+
+// Compares a kernel with scalar on every length up to 67 pixels at each
+// alignment within a 32 byte vector, then on the whole source, so every
+// vector width and its tail handling are covered
+bool check(const KernelSet& set, const KernelSet& scalar, Kernel kernel,
+           const std::vector<uint32_t>& src)
+{
+    const size_t dstBytes = kernelDstBytes[static_cast<size_t>(kernel)];
+    std::vector<uint8_t> expected(src.size() * dstBytes);
+    std::vector<uint8_t> actual(src.size() * dstBytes);
+
+    for (size_t offset = 0; offset < 8; ++offset)
+    {
+        for (size_t count = 0; count <= 67; ++count)
+        {
+            const uint32_t* in = src.data() + offset;
+            run(scalar, kernel, expected.data(), in, count);
+            run(set, kernel, actual.data(), in, count);
+            if (memcmp(expected.data(), actual.data(), count * dstBytes))
+            {
+                printf("%s %s differs from scalar on %zu pixels\n", set.name,
+                       kernelNames[static_cast<size_t>(kernel)], count);
+                return false;
+            }
+        }
+    }
+
+    // An odd length, so the last vector is partial
+    const size_t count = src.size() - 1;
+    run(scalar, kernel, expected.data(), src.data() + 1, count);
+    run(set, kernel, actual.data(), src.data() + 1, count);
+    for (size_t i = 0; i < count * dstBytes; ++i)
+    {
+        if (expected[i] != actual[i])
+        {
+            printf("%s %s differs from scalar at pixel %zu (source %08x)\n",
+                   set.name, kernelNames[static_cast<size_t>(kernel)],
+                   i / dstBytes, src[1 + i / dstBytes]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Bytes read and written per second, in GB/s
+double measure(const KernelSet& set, Kernel kernel,
+               const std::vector<uint32_t>& src)
+{
+    const size_t dstBytes = kernelDstBytes[static_cast<size_t>(kernel)];
+    std::vector<uint8_t> dst(src.size() * dstBytes);
+    using Clock = std::chrono::steady_clock;
+
+    // Warm the caches and the clock speed up first
+    run(set, kernel, dst.data(), src.data(), src.size());
+    size_t runs = 0;
+    const Clock::time_point start = Clock::now();
+    Clock::duration elapsed;
+    do
+    {
+        run(set, kernel, dst.data(), src.data(), src.size());
+        ++runs;
+        elapsed = Clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(250));
+
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    const double bytes =
+        static_cast<double>(runs) * src.size() * (sizeof(uint32_t) + dstBytes);
+    return bytes / seconds / 1e9;
+}
+}
+
+int main()
+{
+    const KernelSet* sets = nullptr;
+    const size_t setCount = kernelSets(&sets);
+    const KernelSet& scalar = sets[setCount - 1];
+    printf("Kernel set in use: %s\n\n", kernelName());
+
+    const std::vector<uint32_t> checkSource = makeSource(kCheckPixels + 1);
+    const std::vector<uint32_t> benchSource = makeSource(kBenchPixels);
+    bool same = true;
+
+    printf("%-8s %-12s %10s\n", "set", "kernel", "GB/s");
+    for (size_t i = 0; i < setCount; ++i)
+    {
+        for (size_t k = 0; k < static_cast<size_t>(Kernel::KernelMax); ++k)
+        {
+            const Kernel kernel = static_cast<Kernel>(k);
+            if (&sets[i] != &scalar)
+            {
+                same = check(sets[i], scalar, kernel, checkSource) && same;
+            }
+            printf("%-8s %-12s %10.2f\n", sets[i].name, kernelNames[k],
+                   measure(sets[i], kernel, benchSource));
+        }
+    }
+
+    printf("\n%s\n", same ? "All kernels match scalar."
+                          : "Some kernels differ from scalar.");
+    return same ? 0 : 1;
+}
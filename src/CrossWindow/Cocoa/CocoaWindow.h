@@ -14,11 +14,16 @@ struct Window {
 	Window() = default;
 	~Window();
 	[[nodiscard]] auto create(const WindowDesc& desc, EventQueue& eventQueue, void* parentWindow) -> bool;
-	[[nodiscard]] auto get_client_data() -> std::any { return client_data; }
+	[[nodiscard]] auto get_client_data() const -> const std::any& { return client_data; }
+	// Application object behind the window, a single load from an event handler. Not owned, unlike client data
+	template <typename T>
+	[[nodiscard]] auto get_user() const -> T* { return static_cast<T*>(mUserData); }
 	[[nodiscard]] auto get_native_handle() -> void*;
 	[[nodiscard]] auto is_valid() const -> bool { return bool(view); }
 	auto destroy() -> void;
-	auto set_client_data(std::any data) -> void { client_data = data; }
+	auto set_client_data(std::any data) -> void { client_data = std::move(data); }
+	template <typename T>
+	auto set_user(T* data) -> void { mUserData = data; }
 	auto set_position(unsigned x, unsigned y) -> void;
 	auto set_size(unsigned width, unsigned height) -> void;
 	auto get_native_handle() -> void*;
@@ -34,6 +39,7 @@ struct Window {
 	void setLayer(LayerType type);
   protected:
 	std::any client_data;
+	void* mUserData = nullptr;
 	// NSString*
 	void* mTitle = nullptr;
 	// XWinWindow*
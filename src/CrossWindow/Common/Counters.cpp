@@ -0,0 +1,65 @@
+#include "Counters.h"
+
+#include <atomic>
+
+namespace xwin
+{
+namespace
+{
+constexpr size_t kCounterCount = static_cast<size_t>(Counter::CounterMax);
+constexpr size_t kEventCountCount =
+    static_cast<size_t>(EventCount::EventCountMax);
+constexpr size_t kEventTypeCount = static_cast<size_t>(EventType::EventTypeMax);
+
+// Nothing is ordered against the counts, relaxed adds are enough
+std::atomic<uint64_t> sCounters[kCounterCount];
+std::atomic<uint64_t> sEvents[kEventCountCount][kEventTypeCount];
+
+CounterSnapshot collect(bool reset)
+{
+    CounterSnapshot snapshot;
+    for (size_t i = 0; i < kCounterCount; ++i)
+    {
+        snapshot.counters[i] =
+            reset ? sCounters[i].exchange(0, std::memory_order_relaxed)
+                  : sCounters[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < kEventCountCount; ++i)
+    {
+        for (size_t j = 0; j < kEventTypeCount; ++j)
+        {
+            snapshot.events[i][j] =
+                reset ? sEvents[i][j].exchange(0, std::memory_order_relaxed)
+                      : sEvents[i][j].load(std::memory_order_relaxed);
+        }
+    }
+    return snapshot;
+}
+}
+
+void count(Counter counter, uint64_t amount)
+{
+    sCounters[static_cast<size_t>(counter)].fetch_add(
+        amount, std::memory_order_relaxed);
+}
+
+void countEvent(EventCount kind, EventType type)
+{
+    sEvents[static_cast<size_t>(kind)][static_cast<size_t>(type)].fetch_add(
+        1, std::memory_order_relaxed);
+}
+
+CounterSnapshot snapshotCounters() { return collect(false); }
+
+CounterSnapshot resetCounters() { return collect(true); }
+
+UpdateTimer::~UpdateTimer()
+{
+    const auto elapsed = std::chrono::steady_clock::now() - mStart;
+    count(Counter::Updates);
+    count(Counter::UpdateNanoseconds,
+          static_cast<uint64_t>(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                  .count()));
+}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Event.h"
+
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace xwin
+{
+/**
+ * Process wide activity of the EventQueue and backend, meant to be left on:
+ * each count is a relaxed atomic add. Take a snapshot every frame or so and
+ * export the difference to telemetry.
+ */
+enum class Counter : size_t
+{
+    // Events read from the display server, before decoding and batching
+    EventsRead = 0,
+
+    // Times the queue went to the connection for more input, blocking or not
+    SocketReads,
+
+    // Output buffer flushes
+    Flushes,
+
+    // Requests whose reply was waited for, a batch of pipelined requests
+    // counts once
+    RoundTrips,
+
+    // Calls to EventQueue::update() and the time spent in them
+    Updates,
+    UpdateNanoseconds,
+
+    CounterMax
+};
+
+/**
+ * What happened to events of a given type on their way to the application
+ */
+enum class EventCount : size_t
+{
+    // Decoded and queued
+    Queued = 0,
+
+    // Folded into an event already queued or batched
+    Coalesced,
+
+    // Discarded, by an overflow policy or because their window is gone
+    Dropped,
+
+    // Handed to the application by EventQueue::pop()
+    Delivered,
+
+    EventCountMax
+};
+
+struct CounterSnapshot
+{
+    uint64_t counters[static_cast<size_t>(Counter::CounterMax)] = {};
+
+    uint64_t events[static_cast<size_t>(EventCount::EventCountMax)]
+                   [static_cast<size_t>(EventType::EventTypeMax)] = {};
+
+    uint64_t get(Counter counter) const
+    {
+        return counters[static_cast<size_t>(counter)];
+    }
+
+    uint64_t get(EventCount count, EventType type) const
+    {
+        return events[static_cast<size_t>(count)][static_cast<size_t>(type)];
+    }
+};
+
+void count(Counter counter, uint64_t amount = 1);
+
+void countEvent(EventCount kind, EventType type);
+
+CounterSnapshot snapshotCounters();
+
+// Returns the counts so far and starts again from zero. Counts made by
+// other threads meanwhile land in one snapshot or the next, never both
+CounterSnapshot resetCounters();
+
+// Counts one EventQueue::update() and the time until it leaves scope
+class UpdateTimer
+{
+  public:
+    UpdateTimer() : mStart(std::chrono::steady_clock::now()) {}
+
+    ~UpdateTimer();
+
+  protected:
+    std::chrono::steady_clock::time_point mStart;
+};
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Standard pointer shapes a window can show
+ */
+namespace xwin
+{
+enum class CursorShape : size_t
+{
+    Arrow = 0,
+    // Text insertion I-beam
+    Text,
+    // Pointing hand over links and buttons
+    Hand,
+    Crosshair,
+    // Busy
+    Wait,
+    // Left/right edge resize
+    ResizeHorizontal,
+    // Top/bottom edge resize
+    ResizeVertical,
+    // Top left/bottom right corner resize
+    ResizeNwse,
+    // Top right/bottom left corner resize
+    ResizeNesw,
+    // Moving in every direction, such as dragging a knob or panel
+    Move,
+    NotAllowed,
+    CursorShapeMax
+};
+}
@@ -0,0 +1,177 @@
+#include "DamageRegion.h"
+
+#include <algorithm>
+
+namespace xwin
+{
+size_t DamageRegion::readBand(size_t begin)
+{
+    mSpans.clear();
+    size_t end = begin;
+    while (end < mRects.size() && mRects[end].y == mRects[begin].y)
+    {
+        const Rect& r = mRects[end];
+        mSpans.push_back({r.x, r.x + static_cast<int>(r.width)});
+        ++end;
+    }
+    return end;
+}
+
+void DamageRegion::appendBand(int y0, int y1, const std::vector<Span>& spans)
+{
+    if (spans.empty() || y0 >= y1)
+    {
+        return;
+    }
+
+    // Extend the previous band instead when it touches and has the same spans
+    const size_t lastCount = mBuild.size() - mLastBand;
+    if (lastCount == spans.size() &&
+        mBuild[mLastBand].y + static_cast<int>(mBuild[mLastBand].height) == y0)
+    {
+        bool same = true;
+        for (size_t i = 0; i < lastCount && same; ++i)
+        {
+            const Rect& r = mBuild[mLastBand + i];
+            same = r.x == spans[i].x0 &&
+                   r.x + static_cast<int>(r.width) == spans[i].x1;
+        }
+        if (same)
+        {
+            for (size_t i = mLastBand; i < mBuild.size(); ++i)
+            {
+                mBuild[i].height += static_cast<unsigned>(y1 - y0);
+            }
+            return;
+        }
+    }
+
+    mLastBand = mBuild.size();
+    for (const Span& span : spans)
+    {
+        mBuild.emplace_back(span.x0, y0, static_cast<unsigned>(span.x1 - span.x0),
+                            static_cast<unsigned>(y1 - y0));
+    }
+}
+
+void DamageRegion::add(const Rect& rect)
+{
+    if (rect.width == 0 || rect.height == 0)
+    {
+        return;
+    }
+    const int rx0 = rect.x;
+    const int rx1 = rect.x + static_cast<int>(rect.width);
+    const int ry0 = rect.y;
+    const int ry1 = rect.y + static_cast<int>(rect.height);
+
+    mBuild.clear();
+    mLastBand = 0;
+
+    // Top of the part of rect no band has covered yet
+    int cursor = ry0;
+    size_t begin = 0;
+    while (begin < mRects.size())
+    {
+        const int by0 = mRects[begin].y;
+        const int by1 = by0 + static_cast<int>(mRects[begin].height);
+        const size_t end = readBand(begin);
+
+        // Rows of rect above this band get a band of their own
+        if (cursor < ry1 && cursor < by0)
+        {
+            const int gapEnd = std::min(ry1, by0);
+            mMerged.assign(1, Span{rx0, rx1});
+            appendBand(cursor, gapEnd, mMerged);
+            cursor = gapEnd;
+        }
+
+        const int oy0 = std::max(by0, ry0);
+        const int oy1 = std::min(by1, ry1);
+        if (oy0 >= oy1)
+        {
+            appendBand(by0, by1, mSpans);
+        }
+        else
+        {
+            // Merge rect into the band's spans for the rows they share,
+            // joining spans it overlaps or touches
+            mMerged.clear();
+            Span merged = {rx0, rx1};
+            bool placed = false;
+            for (const Span& span : mSpans)
+            {
+                if (span.x1 < merged.x0)
+                {
+                    mMerged.push_back(span);
+                }
+                else if (span.x0 > merged.x1)
+                {
+                    if (!placed)
+                    {
+                        mMerged.push_back(merged);
+                        placed = true;
+                    }
+                    mMerged.push_back(span);
+                }
+                else
+                {
+                    merged.x0 = std::min(merged.x0, span.x0);
+                    merged.x1 = std::max(merged.x1, span.x1);
+                }
+            }
+            if (!placed)
+            {
+                mMerged.push_back(merged);
+            }
+
+            appendBand(by0, oy0, mSpans);
+            appendBand(oy0, oy1, mMerged);
+            appendBand(oy1, by1, mSpans);
+            cursor = std::max(cursor, oy1);
+        }
+        begin = end;
+    }
+
+    if (cursor < ry1)
+    {
+        mMerged.assign(1, Span{rx0, rx1});
+        appendBand(cursor, ry1, mMerged);
+    }
+
+    mRects.swap(mBuild);
+}
+
+Rect DamageRegion::bounds() const
+{
+    if (mRects.empty())
+    {
+        return Rect();
+    }
+    int x0 = mRects.front().x;
+    int x1 = x0 + static_cast<int>(mRects.front().width);
+    for (const Rect& r : mRects)
+    {
+        x0 = std::min(x0, r.x);
+        x1 = std::max(x1, r.x + static_cast<int>(r.width));
+    }
+    const int y0 = mRects.front().y;
+    const int y1 = mRects.back().y + static_cast<int>(mRects.back().height);
+    return Rect(x0, y0, static_cast<unsigned>(x1 - x0), static_cast<unsigned>(y1 - y0));
+}
+
+size_t DamageRegion::copyTo(Rect* out, size_t capacity) const
+{
+    if (mRects.empty() || capacity == 0)
+    {
+        return 0;
+    }
+    if (mRects.size() > capacity)
+    {
+        out[0] = bounds();
+        return 1;
+    }
+    std::copy(mRects.begin(), mRects.end(), out);
+    return mRects.size();
+}
+}
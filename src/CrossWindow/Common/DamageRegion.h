@@ -0,0 +1,56 @@
+#pragma once
+
+#include "WindowDesc.h"
+
+#include <stddef.h>
+#include <vector>
+
+namespace xwin
+{
+/**
+ * A union of rectangles kept as y-x bands, like X server regions: rects are
+ * sorted top to bottom then left to right, rects in a band share their y and
+ * height, and never overlap. Adding a rect splits the bands it crosses and
+ * merges spans, and bands that end up identical are joined back together.
+ */
+class DamageRegion
+{
+  public:
+    void add(const Rect& rect);
+
+    void clear() { mRects.clear(); }
+
+    bool empty() const { return mRects.empty(); }
+
+    const std::vector<Rect>& rects() const { return mRects; }
+
+    // Smallest rect containing the whole region
+    Rect bounds() const;
+
+    // Copies the region into out, or its bounds if it needs more than
+    // capacity rects. Returns the number of rects written.
+    size_t copyTo(Rect* out, size_t capacity) const;
+
+  protected:
+    struct Span
+    {
+        int x0;
+        int x1;
+    };
+
+    // Spans of the band of mRects starting at begin, returns its end
+    size_t readBand(size_t begin);
+
+    // Appends spans as the band [y0, y1) of mBuild, joining it to the
+    // previous band when they line up
+    void appendBand(int y0, int y1, const std::vector<Span>& spans);
+
+    std::vector<Rect> mRects;
+
+    // Reused between calls so adding rects does not allocate once warm
+    std::vector<Rect> mBuild;
+    std::vector<Span> mSpans;
+    std::vector<Span> mMerged;
+    size_t mLastBand = 0;
+};
+}
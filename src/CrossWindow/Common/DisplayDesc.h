@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+
+/**
+ * Description of a connected display
+ */
+namespace xwin
+{
+struct DisplayDesc
+{
+    // Output name, such as "DP-1"
+    std::string name;
+
+    // Left edge in virtual desktop coordinates
+    int x = 0;
+    // Top edge in virtual desktop coordinates
+    int y = 0;
+    // Width in pixels
+    unsigned width = 0;
+    // Height in pixels
+    unsigned height = 0;
+
+    // Physical width in millimeters, 0 if unknown
+    unsigned widthMillimeters = 0;
+    // Physical height in millimeters, 0 if unknown
+    unsigned heightMillimeters = 0;
+
+    // Refresh rate in Hz, 0 if unknown
+    double refreshRate = 0.0;
+    // Display scale (DPI / 96) windows on this display should render at
+    float scale = 1.0f;
+    // Whether this is the user's primary display
+    bool primary = false;
+};
+}
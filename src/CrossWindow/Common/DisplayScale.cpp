@@ -0,0 +1,52 @@
+#include "DisplayScale.h"
+
+#include <cmath>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+namespace xwin
+{
+float parseXftDpi(const char* data, size_t length)
+{
+    static const char key[] = "Xft.dpi:";
+    const size_t keyLength = sizeof(key) - 1;
+    const char* end = data + length;
+    for (const char* line = data; line < end;)
+    {
+        const char* newline = static_cast<const char*>(
+            memchr(line, '\n', static_cast<size_t>(end - line)));
+        const char* lineEnd = newline ? newline : end;
+        if (static_cast<size_t>(lineEnd - line) > keyLength &&
+            memcmp(line, key, keyLength) == 0)
+        {
+            const std::string value(line + keyLength, lineEnd);
+            return strtof(value.c_str(), nullptr);
+        }
+        line = lineEnd + 1;
+    }
+    return 0.0f;
+}
+
+float physicalScale(const DisplayDesc& display)
+{
+    if (display.widthMillimeters == 0 || display.heightMillimeters == 0)
+    {
+        return 1.0f;
+    }
+    // Diagonals, so rotated outputs need no special casing
+    const double inches =
+        std::hypot(static_cast<double>(display.widthMillimeters),
+                   static_cast<double>(display.heightMillimeters)) /
+        25.4;
+    const double dpi = std::hypot(static_cast<double>(display.width),
+                                  static_cast<double>(display.height)) /
+                       inches;
+    // Projectors and some drivers report made up sizes
+    if (dpi < 48.0 || dpi > 480.0)
+    {
+        return 1.0f;
+    }
+    return static_cast<float>(dpi / 96.0);
+}
+}
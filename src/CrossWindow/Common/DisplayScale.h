@@ -0,0 +1,16 @@
+#pragma once
+
+#include "DisplayDesc.h"
+
+#include <stddef.h>
+
+namespace xwin
+{
+// Xft.dpi from an X resource database string such as the root window's
+// RESOURCE_MANAGER, 0 when it is not set
+float parseXftDpi(const char* data, size_t length);
+
+// Display scale (DPI / 96) from a display's size in pixels and millimeters,
+// 1 when the physical size is unknown or not believable
+float physicalScale(const DisplayDesc& display);
+}
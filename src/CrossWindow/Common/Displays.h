@@ -0,0 +1,13 @@
+#pragma once
+
+#include "DisplayDesc.h"
+
+#include <vector>
+
+namespace xwin
+{
+// Enumerate each monitor on this machine. Answered from a snapshot the
+// platform refreshes when displays change, so it is cheap and safe to call
+// from any thread. A DisplayChange event follows every refresh that changed it.
+std::vector<DisplayDesc> enumerateDisplays();
+}
@@ -12,6 +12,12 @@ Event::Event(FocusData d, Window* window)
     data.focus = d;
 }
 
+Event::Event(PaintData d, Window* window)
+    : type(EventType::Paint), window(window)
+{
+    data.paint = d;
+}
+
 Event::Event(ResizeData d, Window* window)
     : type(EventType::Resize), window(window)
 {
@@ -65,8 +71,25 @@ Event::Event(DpiData d, Window* window) : type(EventType::DPI), window(window)
     data.dpi = d;
 }
 
+Event::Event(HoverFileData d, Window* window)
+    : type(EventType::HoverFile), window(window)
+{
+    data.hoverFile = d;
+}
+
+Event::Event(DropFileData d, Window* window)
+    : type(EventType::DropFile), window(window)
+{
+    data.dropFile = d;
+}
+
 Event::~Event() {}
 
+PaintData::PaintData(uint64_t msc, uint64_t ust)
+    : msc(msc), ust(ust), rectCount(0)
+{
+}
+
 ResizeData::ResizeData(unsigned width, unsigned height, bool resizing)
     : width(width), height(height), resizing(resizing)
 {
@@ -201,14 +224,30 @@ KeyboardData::KeyboardData(Key key, ButtonState state, ModifierState modifiers)
 {
 }
 
-MouseWheelData::MouseWheelData(double delta, ModifierState modifiers)
-    : delta(delta), modifiers(modifiers)
+MouseWheelData::MouseWheelData(double delta, ModifierState modifiers,
+                               double deltax)
+    : delta(delta), deltax(deltax), modifiers(modifiers)
 {
 }
 
-MouseRawData::MouseRawData(int deltax, int deltay)
+MouseRawData::MouseRawData(double deltax, double deltay)
     : deltax(deltax), deltay(deltay)
 {
 }
+TouchData::TouchData(const TouchPoint& touch, TouchState state)
+    : touch(touch), state(state)
+{
+}
+
 DpiData::DpiData(float scale) : scale(scale) {}
+
+HoverFileData::HoverFileData(int x, int y, bool left) : x(x), y(y), left(left)
+{
+}
+
+DropFileData::DropFileData(int x, int y, const char* const* paths,
+                           size_t count)
+    : x(x), y(y), paths(paths), count(count)
+{
+}
 }
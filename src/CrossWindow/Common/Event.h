@@ -1,6 +1,10 @@
 #pragma once
 
+#include "WindowDesc.h"
+#include "WindowHandle.h"
+
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * Events in CrossWindow are heavily influenced by:
@@ -62,6 +66,13 @@ enum class EventType : size_t
     // Hovering a file over a window
     HoverFile,
 
+    // Displays were added, removed or rearranged, see enumerateDisplays()
+    DisplayChange,
+
+    // Lossy events are being dropped because the queue is full, sent once
+    // each time it fills up with OverflowPolicy::Signal
+    QueueOverflow,
+
     EventTypeMax
 };
 
@@ -78,6 +89,33 @@ struct FocusData
     static const EventType type = EventType::Focus;
 };
 
+/**
+ * Paint data passed with Paint events
+ */
+struct PaintData
+{
+    // Media stream counter (vertical blank count) of the refresh a frame
+    // presented now will land on, 0 if the platform has no vblank timing
+    uint64_t msc;
+
+    // Estimated time of that refresh in microseconds on the platform's
+    // unadjusted system clock, 0 if unknown
+    uint64_t ust;
+
+    // Most dirty rects a Paint event carries, larger damage arrives as its
+    // bounding rect
+    static const size_t maxRects = 16;
+
+    // Regions of the window the platform lost and needs repainted, the whole
+    // window when rectCount is 0
+    Rect rects[maxRects];
+    size_t rectCount;
+
+    PaintData(uint64_t msc = 0, uint64_t ust = 0);
+
+    static const EventType type = EventType::Paint;
+};
+
 /**
  * Resize data passed with Resize events
  */
@@ -285,14 +323,18 @@ struct KeyboardData
     KeyboardData(Key key, ButtonState state, ModifierState modifiers);
 };
 
+/**
+ * Unaccelerated relative mouse motion, may be fractional on high resolution
+ * devices
+ */
 struct MouseRawData
 {
-    int deltax;
-    int deltay;
+    double deltax;
+    double deltay;
 
     static const EventType type = EventType::MouseRaw;
 
-    MouseRawData(int deltax, int deltay);
+    MouseRawData(double deltax, double deltay);
 };
 
 /**
@@ -353,11 +395,17 @@ struct MouseInputData
  */
 struct MouseWheelData
 {
+    // Vertical scroll in wheel notches, positive away from the user. May be
+    // fractional on high resolution devices
     double delta;
+
+    // Horizontal scroll in wheel notches, positive to the right
+    double deltax;
+
     ModifierState modifiers;
     static const EventType type = EventType::MouseWheel;
 
-    MouseWheelData(double delta, ModifierState modifiers);
+    MouseWheelData(double delta, ModifierState modifiers, double deltax = 0.0);
 };
 
 /**
@@ -380,20 +428,34 @@ struct TouchPoint
     // touch coordinate relative to window in pixels.
     unsigned clientY;
 
-    // Did the touch point change
+    // Did the touch point change during the last update
     bool isChanged;
 };
 
 /**
- * Data passed for touch events
+ * The phase of a touch point's lifetime
+ */
+enum class TouchState : size_t
+{
+    Began = 0,
+    Moved,
+    Ended,
+    TouchStateMax
+};
+
+/**
+ * Data passed for touch events. Only the point that changed is sent, the
+ * full set of active touches is kept by the EventQueue.
  */
 struct TouchData
 {
-    unsigned numTouches;
+    TouchPoint touch;
 
-    TouchPoint touches[32];
+    TouchState state;
 
     static const EventType type = EventType::Touch;
+
+    TouchData(const TouchPoint& touch, TouchState state);
 };
 
 /**
@@ -476,12 +538,50 @@ struct GamepadData
     static const EventType type = EventType::Gamepad;
 };
 
+/**
+ * Data passed with HoverFile events while files are dragged over a window.
+ * Moves are coalesced to at most one event per EventQueue update
+ */
+struct HoverFileData
+{
+    // Position relative to the window
+    int x;
+    int y;
+
+    // The drag left the window or was cancelled, the position is unused
+    bool left;
+
+    static const EventType type = EventType::HoverFile;
+
+    HoverFileData(int x, int y, bool left = false);
+};
+
+/**
+ * Data passed with DropFile events, once every path of a drop is available
+ */
+struct DropFileData
+{
+    // Position relative to the window
+    int x;
+    int y;
+
+    // Absolute, decoded paths of the dropped files. They are owned by the
+    // EventQueue and stay valid until its next update
+    const char* const* paths;
+    size_t count;
+
+    static const EventType type = EventType::DropFile;
+
+    DropFileData(int x, int y, const char* const* paths, size_t count);
+};
+
 /**
  * SDL does something similar:
  * <https://www.libsdl.org/release/SDL-1.2.15/docs/html/sdlevent.html>
  */
 union EventData {
     FocusData focus;
+    PaintData paint;
     ResizeData resize;
     DpiData dpi;
     KeyboardData keyboard;
@@ -491,6 +591,8 @@ union EventData {
     TouchData touch;
     GamepadData gamepad;
     MouseRawData mouseRaw;
+    HoverFileData hoverFile;
+    DropFileData dropFile;
 
     EventData() {}
 
@@ -503,9 +605,15 @@ class Event
     // The event's type
     EventType type;
 
-    // Pointer to a CrossWindow window
+    // The window the event is for. Prefer handle: this pointer dangles once
+    // the window is destroyed, even for events still queued
     Window* window;
 
+    // The window the event is for, resolved with EventQueue::getWindow, which
+    // returns null once the window is destroyed. Stamped by the X11 backends
+    // as they route the event, null elsewhere
+    WindowHandle handle;
+
     // Inner data of the event
     EventData data;
     
@@ -513,6 +621,8 @@ class Event
 
     Event(FocusData data, Window* window = nullptr);
 
+    Event(PaintData data, Window* window = nullptr);
+
     Event(ResizeData data, Window* window = nullptr);
 
     Event(KeyboardData data, Window* window = nullptr);
@@ -531,6 +641,10 @@ class Event
 
     Event(DpiData data, Window* window = nullptr);
 
+    Event(HoverFileData data, Window* window = nullptr);
+
+    Event(DropFileData data, Window* window = nullptr);
+
     ~Event();
     
     bool operator==(const Event& other) const
@@ -0,0 +1,224 @@
+#include "EventBuffer.h"
+#include "Counters.h"
+
+#include <iterator>
+
+namespace xwin
+{
+void EventBuffer::setCapacity(size_t capacity, OverflowPolicy policy)
+{
+    mCapacity = capacity;
+    mPolicy = policy;
+}
+
+void EventBuffer::push(const Event& event)
+{
+    if (mCapacity && mEvents.size() >= mCapacity && isState(event))
+    {
+        // Queued past capacity when there is nothing to replace
+        if (supersede(event))
+        {
+            ++mStats.coalesced;
+            countEvent(EventCount::Coalesced, event.type);
+        }
+    }
+    else if (mCapacity && mEvents.size() >= mCapacity && isLossy(event))
+    {
+        switch (mPolicy)
+        {
+        case OverflowPolicy::Coalesce:
+            if (coalesce(event))
+            {
+                ++mStats.coalesced;
+                countEvent(EventCount::Coalesced, event.type);
+                return;
+            }
+            // Nothing to fold into
+            [[fallthrough]];
+        case OverflowPolicy::DropOldest:
+            ++mStats.dropped;
+            if (!dropOldest())
+            {
+                // Only events that must be kept are queued
+                countEvent(EventCount::Dropped, event.type);
+                return;
+            }
+            break;
+        case OverflowPolicy::Signal:
+            if (!mOverflowSignaled)
+            {
+                mOverflowSignaled = true;
+                ++mStats.overflows;
+                countEvent(EventCount::Queued, EventType::QueueOverflow);
+                mEvents.push_back({Event(EventType::QueueOverflow), mNext++});
+            }
+            ++mStats.dropped;
+            countEvent(EventCount::Dropped, event.type);
+            return;
+        default:
+            ++mStats.dropped;
+            countEvent(EventCount::Dropped, event.type);
+            return;
+        }
+    }
+    countEvent(EventCount::Queued, event.type);
+    mEvents.push_back({event, mNext++});
+#if XWIN_TRACE
+    mEvents.back().flow = XWIN_TRACE_FLOW_BEGIN();
+#endif
+}
+
+const Event& EventBuffer::front()
+{
+    skipInvalidated();
+    return mEvents.front().event;
+}
+
+void EventBuffer::pop()
+{
+    countEvent(EventCount::Delivered, mEvents.front().event.type);
+    mEvents.pop_front();
+    if (mEvents.size() < mCapacity)
+    {
+        mOverflowSignaled = false;
+    }
+}
+
+bool EventBuffer::empty()
+{
+    skipInvalidated();
+    return mEvents.empty();
+}
+
+void EventBuffer::invalidate(const Window* window)
+{
+    if (!mEvents.empty())
+    {
+        mInvalidated[window] = mNext;
+    }
+}
+
+void EventBuffer::skipInvalidated()
+{
+    while (!mInvalidated.empty())
+    {
+        if (mEvents.empty())
+        {
+            // Nothing queued before any of the windows went away remains
+            mInvalidated.clear();
+            return;
+        }
+        auto itr = mInvalidated.find(mEvents.front().event.window);
+        if (itr == mInvalidated.end() || mEvents.front().position >= itr->second)
+        {
+            return;
+        }
+        countEvent(EventCount::Dropped, mEvents.front().event.type);
+        mEvents.pop_front();
+    }
+}
+
+bool EventBuffer::isLossy(const Event& event)
+{
+    switch (event.type)
+    {
+    case EventType::MouseMove:
+    case EventType::MouseRaw:
+    case EventType::MouseWheel:
+        return true;
+    case EventType::Touch:
+        return event.data.touch.state == TouchState::Moved;
+    default:
+        return false;
+    }
+}
+
+bool EventBuffer::isState(const Event& event)
+{
+    return event.type == EventType::Resize ||
+           event.type == EventType::HoverFile;
+}
+
+bool EventBuffer::coalesce(const Event& event)
+{
+    for (auto itr = mEvents.rbegin(); itr != mEvents.rend(); ++itr)
+    {
+        Event& queued = itr->event;
+        if (!isLossy(queued))
+        {
+            return false;
+        }
+        if (queued.window != event.window)
+        {
+            continue;
+        }
+        if (queued.type != event.type)
+        {
+            return false;
+        }
+
+        EventData& data = queued.data;
+        switch (event.type)
+        {
+        case EventType::MouseMove:
+            // Latest position, with the motion of both
+            data.mouseMove.deltax += event.data.mouseMove.deltax;
+            data.mouseMove.deltay += event.data.mouseMove.deltay;
+            data.mouseMove.x = event.data.mouseMove.x;
+            data.mouseMove.y = event.data.mouseMove.y;
+            data.mouseMove.screenx = event.data.mouseMove.screenx;
+            data.mouseMove.screeny = event.data.mouseMove.screeny;
+            return true;
+        case EventType::MouseRaw:
+            data.mouseRaw.deltax += event.data.mouseRaw.deltax;
+            data.mouseRaw.deltay += event.data.mouseRaw.deltay;
+            return true;
+        case EventType::MouseWheel:
+            data.mouseWheel.delta += event.data.mouseWheel.delta;
+            data.mouseWheel.deltax += event.data.mouseWheel.deltax;
+            data.mouseWheel.modifiers = event.data.mouseWheel.modifiers;
+            return true;
+        case EventType::Touch:
+            // Other fingers keep their own moves
+            if (data.touch.touch.id != event.data.touch.touch.id)
+            {
+                continue;
+            }
+            data.touch = event.data.touch;
+            return true;
+        default:
+            return false;
+        }
+    }
+    return false;
+}
+
+bool EventBuffer::supersede(const Event& event)
+{
+    // The new one goes to the back, so it keeps its order relative to
+    // everything queued in between
+    for (auto itr = mEvents.rbegin(); itr != mEvents.rend(); ++itr)
+    {
+        if (itr->event.type == event.type && itr->event.window == event.window)
+        {
+            mEvents.erase(std::next(itr).base());
+            return true;
+        }
+    }
+    return false;
+}
+
+bool EventBuffer::dropOldest()
+{
+    for (auto itr = mEvents.begin(); itr != mEvents.end(); ++itr)
+    {
+        if (isLossy(itr->event))
+        {
+            countEvent(EventCount::Dropped, itr->event.type);
+            mEvents.erase(itr);
+            return true;
+        }
+    }
+    return false;
+}
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Event.h"
+#include "Trace.h"
+
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>
+
+namespace xwin
+{
+/**
+ * What an EventBuffer at capacity does with a lossy event: pointer motion,
+ * raw motion, wheel and touch moves. Resizes and file hovers report state, the
+ * latest one for a window replaces the one queued before it and is never
+ * dropped. Every other event, keys, buttons and Close among them, is always
+ * queued.
+ */
+enum class OverflowPolicy : size_t
+{
+    // Drop the oldest lossy event to make room
+    DropOldest = 0,
+
+    // Fold it into the newest queued event of the same kind for the window,
+    // or drop the oldest lossy event when there is none to fold into
+    Coalesce,
+
+    // Drop the incoming event
+    DropNewest,
+
+    // Drop the incoming event, and queue one QueueOverflow event each time
+    // the buffer fills up
+    Signal,
+
+    OverflowPolicyMax
+};
+
+struct EventBufferStats
+{
+    // Lossy events discarded
+    uint64_t dropped = 0;
+
+    // Lossy events folded into one already queued, and state events that
+    // replaced an older one
+    uint64_t coalesced = 0;
+
+    // QueueOverflow events queued
+    uint64_t overflows = 0;
+};
+
+/**
+ * FIFO of events with an optional capacity, so a stalled application does not
+ * pile up motion without bound and then work through stale input.
+ */
+class EventBuffer
+{
+  public:
+    // 0, the default, leaves the buffer unbounded
+    void setCapacity(size_t capacity, OverflowPolicy policy);
+
+    template <typename... Args> void emplace(Args&&... args)
+    {
+        push(Event(std::forward<Args>(args)...));
+    }
+
+    void push(const Event& event);
+
+    // front() and empty() skip the events of invalidated windows
+    const Event& front();
+
+    // Pops the event front() returned, even if its window was invalidated
+    // while the application handled it
+    void pop();
+
+    bool empty();
+
+    size_t size() const { return mEvents.size(); }
+
+    // The events queued so far for window are dropped once they reach the
+    // front, so destroying a window does not scan the queue. Only the address
+    // is compared, a window created there later queues its events past them
+    void invalidate(const Window* window);
+
+    const EventBufferStats& stats() const { return mStats; }
+
+#if XWIN_TRACE
+    // Flow arrow started when the front event was queued
+    uint64_t frontFlow() const { return mEvents.front().flow; }
+#endif
+
+  protected:
+    struct Entry
+    {
+        Event event;
+        uint64_t position;
+#if XWIN_TRACE
+        uint64_t flow = 0;
+#endif
+    };
+
+    static bool isLossy(const Event& event);
+
+    // Resize and HoverFile, only the latest of each for a window matters
+    static bool isState(const Event& event);
+
+    // Removes the newest queued event of the same type for the window
+    bool supersede(const Event& event);
+
+    // Folds event into the newest queued event it can stand in for, without
+    // reaching past anything that has to keep its order relative to it
+    bool coalesce(const Event& event);
+
+    bool dropOldest();
+
+    void skipInvalidated();
+
+    std::deque<Entry> mEvents;
+
+    // Invalidated windows and the position past their last queued event.
+    // Positions count every event ever queued and are not reused by drops
+    std::unordered_map<const Window*, uint64_t> mInvalidated;
+
+    size_t mCapacity = 0;
+
+    OverflowPolicy mPolicy = OverflowPolicy::DropOldest;
+
+    uint64_t mNext = 0;
+
+    // A QueueOverflow went out since the buffer was last below capacity
+    bool mOverflowSignaled = false;
+
+    EventBufferStats mStats;
+};
+}
@@ -1,6 +1,10 @@
 #include "Init.h"
 #include "State.h"
 
+#if defined(XWIN_XCB)
+#include "../XCB/XCBDisplays.h"
+#endif
+
 namespace xwin
 {
 namespace
@@ -11,6 +15,20 @@ XWinState xWinState;
 bool init(MainArgs)
 {
     xWinState = XWinState(MainArgsVars);
+#if defined(XWIN_XCB)
+    // Extension queries ride along with the atom burst
+    xWinState.extensions.prefetch(connection);
+    if (!xWinState.atoms.intern(connection))
+    {
+        return false;
+    }
+    xWinState.extensions.resolve(connection);
+    // Windows are placed by the displays, have them before any is created
+    Requests requests(connection);
+    refresh_displays(connection, screen, xWinState.extensions, requests,
+                     nullptr);
+    requests.wait();
+#endif
     return true;
 }
 const xwin::XWinState& getXWinState() { return xWinState; }
@@ -12,13 +12,21 @@
 #elif defined(XWIN_COCOA) || defined(XWIN_UIKIT)
 #define MainArgs int argc, const char *argv[], void *application
 #define MainArgsVars argc, argv, application
+#elif defined(XWIN_XCB) && XWIN_XCB_XLIB
+#define MainArgs                                                               \
+    int argc, const char *argv[], xcb_connection_t *connection,                \
+        xcb_screen_t *screen, _XDisplay *display
+#define MainArgsVars argc, argv, connection, screen, display
 #elif defined(XWIN_XCB)
 #define MainArgs                                                               \
     int argc, const char *argv[], xcb_connection_t *connection,                \
         xcb_screen_t *screen
 #define MainArgsVars argc, argv, connection, screen
-#elif defined(XWIN_XLIB) || defined(XWIN_MIR) || defined(XWIN_WAYLAND) ||      \
-    defined(XWIN_WASM) || defined(XWIN_NOOP)
+#elif defined(XWIN_XLIB)
+#define MainArgs int argc, const char *argv[], Display *display
+#define MainArgsVars argc, argv, display
+#elif defined(XWIN_MIR) || defined(XWIN_WAYLAND) || defined(XWIN_WASM) ||      \
+    defined(XWIN_NOOP)
 #define MainArgs int argc, const char *argv[]
 #define MainArgsVars argc, argv
 #endif
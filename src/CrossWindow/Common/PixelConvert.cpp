@@ -0,0 +1,440 @@
+#include "PixelConvert.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define XWIN_PIXEL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define XWIN_TARGET_SSE2
+#define XWIN_TARGET_AVX2
+#else
+// Kernels are compiled for their instruction set regardless of the project
+// flags, dispatch makes sure they only run where supported
+#define XWIN_TARGET_SSE2 __attribute__((target("sse2")))
+#define XWIN_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define XWIN_PIXEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace xwin
+{
+namespace pixel
+{
+namespace
+{
+// Scalar kernels, also used for the tails of the vector ones
+
+inline uint32_t widen10(uint32_t c) { return (c << 2) | (c >> 6); }
+
+inline uint32_t mulDiv255(uint32_t c, uint32_t a)
+{
+    const uint32_t t = c * a + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+void rgb565Scalar(uint16_t* dst, const uint32_t* src, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint32_t p = src[i];
+        dst[i] = static_cast<uint16_t>(((p >> 8) & 0xF800) |
+                                       ((p >> 5) & 0x07E0) |
+                                       ((p >> 3) & 0x001F));
+    }
+}
+
+void x2rgb10Scalar(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint32_t p = src[i];
+        dst[i] = 0xC0000000u | (widen10((p >> 16) & 0xFF) << 20) |
+                 (widen10((p >> 8) & 0xFF) << 10) | widen10(p & 0xFF);
+    }
+}
+
+void premultiplyScalar(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint32_t p = src[i];
+        const uint32_t a = p >> 24;
+        dst[i] = (p & 0xFF000000u) | (mulDiv255((p >> 16) & 0xFF, a) << 16) |
+                 (mulDiv255((p >> 8) & 0xFF, a) << 8) |
+                 mulDiv255(p & 0xFF, a);
+    }
+}
+
+void swapRedBlueScalar(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint32_t p = src[i];
+        dst[i] = (p & 0xFF00FF00u) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+    }
+}
+
+#if XWIN_PIXEL_X86
+
+// SSE2, 4 pixels per register
+
+XWIN_TARGET_SSE2 inline __m128i to565Sse2(__m128i p)
+{
+    const __m128i r = _mm_and_si128(_mm_srli_epi32(p, 8), _mm_set1_epi32(0xF800));
+    const __m128i g = _mm_and_si128(_mm_srli_epi32(p, 5), _mm_set1_epi32(0x07E0));
+    const __m128i b = _mm_and_si128(_mm_srli_epi32(p, 3), _mm_set1_epi32(0x001F));
+    const __m128i v = _mm_or_si128(r, _mm_or_si128(g, b));
+    // Sign extend so the signed saturating pack keeps the bits as they are
+    return _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+}
+
+XWIN_TARGET_SSE2 void rgb565Sse2(uint16_t* dst, const uint32_t* src, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128i lo = to565Sse2(_mm_loadu_si128((const __m128i*)(src + i)));
+        const __m128i hi = to565Sse2(_mm_loadu_si128((const __m128i*)(src + i + 4)));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(lo, hi));
+    }
+    rgb565Scalar(dst + i, src + i, count - i);
+}
+
+XWIN_TARGET_SSE2 inline __m128i widen10Sse2(__m128i c)
+{
+    return _mm_or_si128(_mm_slli_epi32(c, 2), _mm_srli_epi32(c, 6));
+}
+
+XWIN_TARGET_SSE2 void x2rgb10Sse2(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xC0000000u));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i p = _mm_loadu_si128((const __m128i*)(src + i));
+        const __m128i r = widen10Sse2(_mm_and_si128(_mm_srli_epi32(p, 16), byteMask));
+        const __m128i g = widen10Sse2(_mm_and_si128(_mm_srli_epi32(p, 8), byteMask));
+        const __m128i b = widen10Sse2(_mm_and_si128(p, byteMask));
+        const __m128i v = _mm_or_si128(_mm_or_si128(opaque, _mm_slli_epi32(r, 20)),
+                                       _mm_or_si128(_mm_slli_epi32(g, 10), b));
+        _mm_storeu_si128((__m128i*)(dst + i), v);
+    }
+    x2rgb10Scalar(dst + i, src + i, count - i);
+}
+
+XWIN_TARGET_SSE2 inline __m128i mulDiv255Sse2(__m128i c)
+{
+    // c holds 2 pixels widened to 16 bits, alpha is word 3 of each
+    const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(c, 0xFF), 0xFF);
+    const __m128i t = _mm_add_epi16(_mm_mullo_epi16(c, a), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+XWIN_TARGET_SSE2 void premultiplySse2(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i p = _mm_loadu_si128((const __m128i*)(src + i));
+        const __m128i lo = mulDiv255Sse2(_mm_unpacklo_epi8(p, zero));
+        const __m128i hi = mulDiv255Sse2(_mm_unpackhi_epi8(p, zero));
+        const __m128i v = _mm_packus_epi16(lo, hi);
+        _mm_storeu_si128((__m128i*)(dst + i),
+                         _mm_or_si128(_mm_andnot_si128(alphaMask, v), _mm_and_si128(p, alphaMask)));
+    }
+    premultiplyScalar(dst + i, src + i, count - i);
+}
+
+XWIN_TARGET_SSE2 void swapRedBlueSse2(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    const __m128i keepMask = _mm_set1_epi32(static_cast<int>(0xFF00FF00u));
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i p = _mm_loadu_si128((const __m128i*)(src + i));
+        const __m128i v = _mm_or_si128(
+            _mm_and_si128(p, keepMask),
+            _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), byteMask),
+                         _mm_slli_epi32(_mm_and_si128(p, byteMask), 16)));
+        _mm_storeu_si128((__m128i*)(dst + i), v);
+    }
+    swapRedBlueScalar(dst + i, src + i, count - i);
+}
+
+// AVX2, 8 pixels per register
+
+XWIN_TARGET_AVX2 inline __m256i to565Avx2(__m256i p)
+{
+    const __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 8), _mm256_set1_epi32(0xF800));
+    const __m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 5), _mm256_set1_epi32(0x07E0));
+    const __m256i b = _mm256_and_si256(_mm256_srli_epi32(p, 3), _mm256_set1_epi32(0x001F));
+    const __m256i v = _mm256_or_si256(r, _mm256_or_si256(g, b));
+    return _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+}
+
+XWIN_TARGET_AVX2 void rgb565Avx2(uint16_t* dst, const uint32_t* src, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m256i lo = to565Avx2(_mm256_loadu_si256((const __m256i*)(src + i)));
+        const __m256i hi = to565Avx2(_mm256_loadu_si256((const __m256i*)(src + i + 8)));
+        // The pack works per 128 bit lane, put the quarters back in order
+        const __m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256((__m256i*)(dst + i), v);
+    }
+    rgb565Scalar(dst + i, src + i, count - i);
+}
+
+XWIN_TARGET_AVX2 inline __m256i widen10Avx2(__m256i c)
+{
+    return _mm256_or_si256(_mm256_slli_epi32(c, 2), _mm256_srli_epi32(c, 6));
+}
+
+XWIN_TARGET_AVX2 void x2rgb10Avx2(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+    const __m256i opaque = _mm256_set1_epi32(static_cast<int>(0xC0000000u));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i p = _mm256_loadu_si256((const __m256i*)(src + i));
+        const __m256i r = widen10Avx2(_mm256_and_si256(_mm256_srli_epi32(p, 16), byteMask));
+        const __m256i g = widen10Avx2(_mm256_and_si256(_mm256_srli_epi32(p, 8), byteMask));
+        const __m256i b = widen10Avx2(_mm256_and_si256(p, byteMask));
+        const __m256i v = _mm256_or_si256(_mm256_or_si256(opaque, _mm256_slli_epi32(r, 20)),
+                                          _mm256_or_si256(_mm256_slli_epi32(g, 10), b));
+        _mm256_storeu_si256((__m256i*)(dst + i), v);
+    }
+    x2rgb10Scalar(dst + i, src + i, count - i);
+}
+
+XWIN_TARGET_AVX2 inline __m256i mulDiv255Avx2(__m256i c)
+{
+    const __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(c, 0xFF), 0xFF);
+    const __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(c, a), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+XWIN_TARGET_AVX2 void premultiplyAvx2(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i p = _mm256_loadu_si256((const __m256i*)(src + i));
+        // Unpack and pack are both per lane, so pixel order survives
+        const __m256i lo = mulDiv255Avx2(_mm256_unpacklo_epi8(p, zero));
+        const __m256i hi = mulDiv255Avx2(_mm256_unpackhi_epi8(p, zero));
+        const __m256i v = _mm256_packus_epi16(lo, hi);
+        _mm256_storeu_si256((__m256i*)(dst + i),
+                            _mm256_or_si256(_mm256_andnot_si256(alphaMask, v),
+                                            _mm256_and_si256(p, alphaMask)));
+    }
+    premultiplyScalar(dst + i, src + i, count - i);
+}
+
+XWIN_TARGET_AVX2 void swapRedBlueAvx2(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                             2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i p = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_shuffle_epi8(p, shuffle));
+    }
+    swapRedBlueScalar(dst + i, src + i, count - i);
+}
+
+bool hasSse2()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return true;
+#elif defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+bool hasAvx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    // The OS has to save the upper halves of the ymm registers too
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+    {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#elif XWIN_PIXEL_NEON
+
+// NEON, 16 pixels per structured load, one register per channel
+
+void rgb565Neon(uint16_t* dst, const uint32_t* src, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const uint8x16x4_t p = vld4q_u8((const uint8_t*)(src + i));
+        // Each insert keeps the bits already placed above it
+        uint16x8_t lo = vshll_n_u8(vget_low_u8(p.val[2]), 8);
+        lo = vsriq_n_u16(lo, vshll_n_u8(vget_low_u8(p.val[1]), 8), 5);
+        lo = vsriq_n_u16(lo, vshll_n_u8(vget_low_u8(p.val[0]), 8), 11);
+        uint16x8_t hi = vshll_n_u8(vget_high_u8(p.val[2]), 8);
+        hi = vsriq_n_u16(hi, vshll_n_u8(vget_high_u8(p.val[1]), 8), 5);
+        hi = vsriq_n_u16(hi, vshll_n_u8(vget_high_u8(p.val[0]), 8), 11);
+        vst1q_u16(dst + i, lo);
+        vst1q_u16(dst + i + 8, hi);
+    }
+    rgb565Scalar(dst + i, src + i, count - i);
+}
+
+inline uint32x4_t widen10Neon(uint32x4_t c)
+{
+    return vorrq_u32(vshlq_n_u32(c, 2), vshrq_n_u32(c, 6));
+}
+
+void x2rgb10Neon(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    const uint32x4_t byteMask = vdupq_n_u32(0xFF);
+    const uint32x4_t opaque = vdupq_n_u32(0xC0000000u);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const uint32x4_t p = vld1q_u32(src + i);
+        const uint32x4_t r = widen10Neon(vandq_u32(vshrq_n_u32(p, 16), byteMask));
+        const uint32x4_t g = widen10Neon(vandq_u32(vshrq_n_u32(p, 8), byteMask));
+        const uint32x4_t b = widen10Neon(vandq_u32(p, byteMask));
+        vst1q_u32(dst + i, vorrq_u32(vorrq_u32(opaque, vshlq_n_u32(r, 20)),
+                                     vorrq_u32(vshlq_n_u32(g, 10), b)));
+    }
+    x2rgb10Scalar(dst + i, src + i, count - i);
+}
+
+inline uint8x16_t mulDiv255Neon(uint8x16_t c, uint8x16_t a)
+{
+    const uint16x8_t lo = vmull_u8(vget_low_u8(c), vget_low_u8(a));
+    const uint16x8_t hi = vmull_u8(vget_high_u8(c), vget_high_u8(a));
+    // (x + ((x + 128) >> 8) + 128) >> 8, the same rounding as the scalar path
+    return vcombine_u8(vraddhn_u16(lo, vrshrq_n_u16(lo, 8)),
+                       vraddhn_u16(hi, vrshrq_n_u16(hi, 8)));
+}
+
+void premultiplyNeon(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16x4_t p = vld4q_u8((const uint8_t*)(src + i));
+        p.val[0] = mulDiv255Neon(p.val[0], p.val[3]);
+        p.val[1] = mulDiv255Neon(p.val[1], p.val[3]);
+        p.val[2] = mulDiv255Neon(p.val[2], p.val[3]);
+        vst4q_u8((uint8_t*)(dst + i), p);
+    }
+    premultiplyScalar(dst + i, src + i, count - i);
+}
+
+void swapRedBlueNeon(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16x4_t p = vld4q_u8((const uint8_t*)(src + i));
+        const uint8x16_t blue = p.val[0];
+        p.val[0] = p.val[2];
+        p.val[2] = blue;
+        vst4q_u8((uint8_t*)(dst + i), p);
+    }
+    swapRedBlueScalar(dst + i, src + i, count - i);
+}
+
+#endif
+
+struct Supported
+{
+    KernelSet sets[4];
+    size_t count = 0;
+};
+
+Supported findSupported()
+{
+    Supported result;
+#if XWIN_PIXEL_X86
+    if (hasAvx2())
+    {
+        result.sets[result.count++] = {rgb565Avx2, x2rgb10Avx2, premultiplyAvx2, swapRedBlueAvx2, "avx2"};
+    }
+    if (hasSse2())
+    {
+        result.sets[result.count++] = {rgb565Sse2, x2rgb10Sse2, premultiplySse2, swapRedBlueSse2, "sse2"};
+    }
+#elif XWIN_PIXEL_NEON
+    result.sets[result.count++] = {rgb565Neon, x2rgb10Neon, premultiplyNeon, swapRedBlueNeon, "neon"};
+#endif
+    result.sets[result.count++] = {rgb565Scalar, x2rgb10Scalar, premultiplyScalar, swapRedBlueScalar, "scalar"};
+    return result;
+}
+
+const Supported& supported()
+{
+    static const Supported found = findSupported();
+    return found;
+}
+
+const KernelSet& kernels() { return supported().sets[0]; }
+}
+
+void convertToRgb565(uint16_t* dst, const uint32_t* src, size_t count)
+{
+    kernels().rgb565(dst, src, count);
+}
+
+void convertToX2Rgb10(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    kernels().x2rgb10(dst, src, count);
+}
+
+void premultiply(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    kernels().premultiply(dst, src, count);
+}
+
+void swapRedBlue(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    kernels().swapRedBlue(dst, src, count);
+}
+
+const char* kernelName() { return kernels().name; }
+
+size_t kernelSets(const KernelSet** sets)
+{
+    *sets = supported().sets;
+    return supported().count;
+}
+}
+}
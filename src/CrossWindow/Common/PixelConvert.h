@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Pixel conversion kernels for CPU rendered content. Sources are 32 bit
+ * BGRA in memory, that is 0xAARRGGBB read as a little endian uint32_t, the
+ * layout 24 and 32 bit visuals use. The fastest kernel set the CPU supports
+ * (AVX2, SSE2, NEON or scalar) is picked on first use.
+ */
+namespace xwin
+{
+namespace pixel
+{
+// Packs to 16 bit 5:6:5, truncating the low bits of each channel
+void convertToRgb565(uint16_t* dst, const uint32_t* src, size_t count);
+
+// Widens to 2:10:10:10 for 30 bit visuals, replicating the high bits into
+// the new low bits so white stays white
+void convertToX2Rgb10(uint32_t* dst, const uint32_t* src, size_t count);
+
+// Multiplies each colour channel by alpha, rounded as c * a / 255
+void premultiply(uint32_t* dst, const uint32_t* src, size_t count);
+
+// Swaps red and blue, turning the RGBA bytes image decoders produce into BGRA
+void swapRedBlue(uint32_t* dst, const uint32_t* src, size_t count);
+
+// Name of the kernel set in use: "avx2", "sse2", "neon" or "scalar"
+const char* kernelName();
+
+// One implementation of each of the conversions above
+struct KernelSet
+{
+    void (*rgb565)(uint16_t*, const uint32_t*, size_t);
+    void (*x2rgb10)(uint32_t*, const uint32_t*, size_t);
+    void (*premultiply)(uint32_t*, const uint32_t*, size_t);
+    void (*swapRedBlue)(uint32_t*, const uint32_t*, size_t);
+    const char* name;
+};
+
+// Every kernel set the CPU can run, the one in use first and scalar last,
+// so they can be checked and timed against each other. Returns the count
+size_t kernelSets(const KernelSet** sets);
+}
+}
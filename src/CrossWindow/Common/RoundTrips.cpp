@@ -0,0 +1,139 @@
+#include "RoundTrips.h"
+
+#include <limits>
+#include <mutex>
+#include <stdio.h>
+
+namespace xwin
+{
+namespace
+{
+// No frame is over budget until one is set
+unsigned sBudget = std::numeric_limits<unsigned>::max();
+RoundTripBudgetHandler sBudgetHandler;
+
+#if XWIN_ROUND_TRIP_AUDIT
+// Sites only ever get added, readers walk the list without the lock
+std::mutex sSitesMutex;
+std::atomic<RoundTripSite*> sSites{nullptr};
+
+void printFrame(const RoundTripFrame& frame)
+{
+    fprintf(stderr,
+            "CrossWindow: %llu blocking round trips took %.3f ms this frame, "
+            "budget %u\n",
+            static_cast<unsigned long long>(frame.count),
+            static_cast<double>(frame.nanoseconds) / 1e6, sBudget);
+    for (const RoundTripStats& site : frame.sites)
+    {
+        fprintf(stderr, "  %s:%d %s: %llu, %.3f ms\n", site.file, site.line,
+                site.function,
+                static_cast<unsigned long long>(site.frameCount),
+                static_cast<double>(site.frameNanoseconds) / 1e6);
+    }
+}
+#endif
+}
+
+void setRoundTripBudget(unsigned maxRoundTrips, RoundTripBudgetHandler handler)
+{
+    sBudget = maxRoundTrips;
+    sBudgetHandler = std::move(handler);
+}
+
+#if XWIN_ROUND_TRIP_AUDIT
+RoundTripSite::RoundTripSite(const char* file, int line, const char* function)
+    : mFile(file), mLine(line), mFunction(function)
+{
+    std::lock_guard<std::mutex> lock(sSitesMutex);
+    mNext = sSites.load(std::memory_order_relaxed);
+    sSites.store(this, std::memory_order_release);
+}
+
+void RoundTripSite::record(uint64_t nanoseconds)
+{
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    mNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    mFrameCount.fetch_add(1, std::memory_order_relaxed);
+    mFrameNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+RoundTripScope::~RoundTripScope()
+{
+    const auto elapsed = std::chrono::steady_clock::now() - mStart;
+    count(Counter::RoundTrips);
+    mSite.record(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+}
+
+std::vector<RoundTripStats> roundTripSites()
+{
+    std::vector<RoundTripStats> sites;
+    for (RoundTripSite* site = sSites.load(std::memory_order_acquire); site;
+         site = site->mNext)
+    {
+        const uint64_t count = site->mCount.load(std::memory_order_relaxed);
+        if (count)
+        {
+            sites.push_back(
+                {site->mFile, site->mLine, site->mFunction, count,
+                 site->mNanoseconds.load(std::memory_order_relaxed),
+                 site->mFrameCount.load(std::memory_order_relaxed),
+                 site->mFrameNanoseconds.load(std::memory_order_relaxed)});
+        }
+    }
+    return sites;
+}
+
+void resetRoundTrips()
+{
+    for (RoundTripSite* site = sSites.load(std::memory_order_acquire); site;
+         site = site->mNext)
+    {
+        site->mCount.store(0, std::memory_order_relaxed);
+        site->mNanoseconds.store(0, std::memory_order_relaxed);
+    }
+}
+
+void finishRoundTripFrame()
+{
+    RoundTripFrame frame;
+    for (RoundTripSite* site = sSites.load(std::memory_order_acquire); site;
+         site = site->mNext)
+    {
+        const uint64_t count =
+            site->mFrameCount.exchange(0, std::memory_order_relaxed);
+        const uint64_t nanoseconds =
+            site->mFrameNanoseconds.exchange(0, std::memory_order_relaxed);
+        if (count)
+        {
+            frame.count += count;
+            frame.nanoseconds += nanoseconds;
+            frame.sites.push_back({site->mFile, site->mLine, site->mFunction,
+                                   site->mCount.load(std::memory_order_relaxed),
+                                   site->mNanoseconds.load(
+                                       std::memory_order_relaxed),
+                                   count, nanoseconds});
+        }
+    }
+    if (frame.count <= sBudget)
+    {
+        return;
+    }
+    if (sBudgetHandler)
+    {
+        sBudgetHandler(frame);
+    }
+    else
+    {
+        printFrame(frame);
+    }
+}
+#else
+std::vector<RoundTripStats> roundTripSites() { return {}; }
+
+void resetRoundTrips() {}
+
+void finishRoundTripFrame() {}
+#endif
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Counters.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Marks the rest of the enclosing block as a blocking wait on the display
+ * server. It always counts Counter::RoundTrips. Built with
+ * XWIN_ROUND_TRIP_AUDIT it also times the wait against its call site, and
+ * frames with more round trips than the budget are reported.
+ */
+#if XWIN_ROUND_TRIP_AUDIT
+#define XWIN_ROUND_TRIP_SCOPE()                                                \
+    static xwin::RoundTripSite xwinRoundTripSite(__FILE__, __LINE__,           \
+                                                 __func__);                    \
+    xwin::RoundTripScope xwinRoundTripScope(xwinRoundTripSite)
+#else
+#define XWIN_ROUND_TRIP_SCOPE() xwin::count(xwin::Counter::RoundTrips)
+#endif
+
+namespace xwin
+{
+struct RoundTripStats
+{
+    const char* file;
+    int line;
+    const char* function;
+
+    // Since the last resetRoundTrips()
+    uint64_t count;
+    uint64_t nanoseconds;
+
+    // Since the frame began
+    uint64_t frameCount;
+    uint64_t frameNanoseconds;
+};
+
+struct RoundTripFrame
+{
+    uint64_t count = 0;
+    uint64_t nanoseconds = 0;
+
+    // Sites that waited during the frame
+    std::vector<RoundTripStats> sites;
+};
+
+// Called with frames over budget. The default prints them to stderr
+using RoundTripBudgetHandler = std::function<void(const RoundTripFrame&)>;
+
+// Frames with more than maxRoundTrips blocking waits go to handler, or to
+// stderr when it is empty. Without XWIN_ROUND_TRIP_AUDIT nothing is timed
+// and the handler never runs
+void setRoundTripBudget(unsigned maxRoundTrips,
+                        RoundTripBudgetHandler handler = nullptr);
+
+// Every site that has waited since the last reset
+std::vector<RoundTripStats> roundTripSites();
+
+void resetRoundTrips();
+
+// Closes the frame and checks it against the budget, EventQueue::update()
+// calls this so a frame is the work done between two updates
+void finishRoundTripFrame();
+
+#if XWIN_ROUND_TRIP_AUDIT
+/**
+ * One per call site, registered the first time it waits
+ */
+class RoundTripSite
+{
+  public:
+    RoundTripSite(const char* file, int line, const char* function);
+
+    void record(uint64_t nanoseconds);
+
+  protected:
+    friend std::vector<RoundTripStats> roundTripSites();
+    friend void resetRoundTrips();
+    friend void finishRoundTripFrame();
+
+    const char* mFile;
+    int mLine;
+    const char* mFunction;
+    std::atomic<uint64_t> mCount{0};
+    std::atomic<uint64_t> mNanoseconds{0};
+    std::atomic<uint64_t> mFrameCount{0};
+    std::atomic<uint64_t> mFrameNanoseconds{0};
+    RoundTripSite* mNext = nullptr;
+};
+
+class RoundTripScope
+{
+  public:
+    explicit RoundTripScope(RoundTripSite& site)
+        : mSite(site), mStart(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~RoundTripScope();
+
+  protected:
+    RoundTripSite& mSite;
+    std::chrono::steady_clock::time_point mStart;
+};
+#endif
+}
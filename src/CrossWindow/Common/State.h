@@ -3,7 +3,13 @@
 #if defined(XWIN_WIN32)
 #include <Windows.h>
 #elif defined(XWIN_XCB)
+#include "../XCB/XCBAtomCache.h"
+#include "../XCB/XCBExtensions.h"
 #include <xcb/xcb.h>
+#if XWIN_XCB_XLIB
+// Xlib's Display, without pulling its macros into every header
+struct _XDisplay;
+#endif
 #elif defined(XWIN_XLIB)
 #include <X11/Xlib.h>
 #endif
@@ -41,11 +47,35 @@ struct XWinState
     const char** argv;
     xcb_connection_t* connection;
     xcb_screen_t* screen;
+    AtomCache atoms;
+    Extensions extensions;
+#if XWIN_XCB_XLIB
+    // Owner of connection, for libraries such as GLX that need a Display.
+    // Events are still read and decoded through XCB
+    _XDisplay* display;
+    XWinState(int argc, const char** argv, xcb_connection_t* connection,
+              xcb_screen_t* screen, _XDisplay* display)
+        : argc(argc), argv(argv), connection(connection), screen(screen),
+          display(display)
+    {
+    }
+#else
     XWinState(int argc, const char** argv, xcb_connection_t* connection,
               xcb_screen_t* screen)
         : argc(argc), argv(argv), connection(connection), screen(screen)
     {
     }
+#endif
+
+#elif defined(XWIN_XLIB)
+    int argc;
+    const char** argv;
+    // Opened once by main and shared by every window and EventQueue
+    Display* display;
+    XWinState(int argc, const char** argv, Display* display)
+        : argc(argc), argv(argv), display(display)
+    {
+    }
 
 #elif defined(XWIN_ANDROID)
 
@@ -0,0 +1,209 @@
+#include "Trace.h"
+
+#if XWIN_TRACE
+#include <atomic>
+#include <stdio.h>
+#endif
+
+namespace xwin
+{
+#if XWIN_TRACE
+namespace
+{
+struct Record
+{
+    const char* name;
+    uint64_t start;
+    uint64_t duration;
+    uint64_t id;
+
+    // Chrome trace phase: X span, s and f flow start and end
+    char phase;
+};
+
+// Filled by one thread and read by stopTrace(), count publishes records
+struct Chunk
+{
+    static constexpr size_t kRecords = 4096;
+
+    Record records[kRecords];
+    std::atomic<size_t> count{0};
+    std::atomic<Chunk*> next{nullptr};
+};
+
+struct ThreadTrace
+{
+    uint32_t tid;
+
+    // Owned by the thread
+    Chunk* last;
+
+    // Owned by stopTrace(), where the previous trace stopped reading
+    Chunk* readChunk;
+    size_t readCount = 0;
+
+    ThreadTrace* next;
+};
+
+std::atomic<bool> sEnabled{false};
+std::atomic<ThreadTrace*> sThreads{nullptr};
+std::atomic<uint32_t> sNextTid{1};
+std::atomic<uint64_t> sNextFlow{1};
+const std::chrono::steady_clock::time_point sOrigin =
+    std::chrono::steady_clock::now();
+
+uint64_t now()
+{
+    // Never 0, that marks a span started while recording was off
+    return static_cast<uint64_t>(
+               std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - sOrigin)
+                   .count()) +
+           1;
+}
+
+// Buffers live as long as the process, a thread that exits leaves its
+// records for the next stopTrace(). Chunks are freed once read
+ThreadTrace* threadTrace()
+{
+    thread_local ThreadTrace* trace = nullptr;
+    if (!trace)
+    {
+        trace = new ThreadTrace();
+        trace->tid = sNextTid.fetch_add(1, std::memory_order_relaxed);
+        trace->last = new Chunk();
+        trace->readChunk = trace->last;
+        trace->next = sThreads.load(std::memory_order_relaxed);
+        while (!sThreads.compare_exchange_weak(trace->next, trace,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed))
+        {
+        }
+    }
+    return trace;
+}
+
+void append(char phase, const char* name, uint64_t start, uint64_t duration,
+            uint64_t id)
+{
+    ThreadTrace* trace = threadTrace();
+    Chunk* chunk = trace->last;
+    size_t count = chunk->count.load(std::memory_order_relaxed);
+    if (count == Chunk::kRecords)
+    {
+        Chunk* fresh = new Chunk();
+        chunk->next.store(fresh, std::memory_order_release);
+        trace->last = fresh;
+        chunk = fresh;
+        count = 0;
+    }
+    chunk->records[count] = {name, start, duration, id, phase};
+    chunk->count.store(count + 1, std::memory_order_release);
+}
+
+void write(FILE* file, const Record& record, uint32_t tid, bool& first)
+{
+    const double ts = static_cast<double>(record.start) / 1000.0;
+    fprintf(file, first ? "\n" : ",\n");
+    first = false;
+    if (record.phase == 'X')
+    {
+        fprintf(file,
+                "{\"name\":\"%s\",\"cat\":\"xwin\",\"ph\":\"X\",\"ts\":%.3f,"
+                "\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                record.name, ts, static_cast<double>(record.duration) / 1000.0,
+                tid);
+    }
+    else
+    {
+        // Flow ends bind to the span they are in, not the next one
+        fprintf(file,
+                "{\"name\":\"event\",\"cat\":\"xwin\",\"ph\":\"%c\",\"ts\":%.3f,"
+                "\"id\":%llu,\"pid\":1,\"tid\":%u%s}",
+                record.phase, ts, static_cast<unsigned long long>(record.id),
+                tid, record.phase == 'f' ? ",\"bp\":\"e\"" : "");
+    }
+}
+}
+
+void startTrace() { sEnabled.store(true, std::memory_order_relaxed); }
+
+bool stopTrace(const char* path)
+{
+    sEnabled.store(false, std::memory_order_relaxed);
+    FILE* file = fopen(path, "w");
+    if (!file)
+    {
+        return false;
+    }
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    bool first = true;
+    for (ThreadTrace* trace = sThreads.load(std::memory_order_acquire); trace;
+         trace = trace->next)
+    {
+        for (;;)
+        {
+            Chunk* chunk = trace->readChunk;
+            const size_t count = chunk->count.load(std::memory_order_acquire);
+            for (; trace->readCount < count; ++trace->readCount)
+            {
+                write(file, chunk->records[trace->readCount], trace->tid,
+                      first);
+            }
+            Chunk* next = chunk->next.load(std::memory_order_acquire);
+            if (!next || count < Chunk::kRecords)
+            {
+                break;
+            }
+            // The thread moved on to next and never touches this one again
+            delete chunk;
+            trace->readChunk = next;
+            trace->readCount = 0;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
+
+uint64_t traceFlowBegin()
+{
+    if (!sEnabled.load(std::memory_order_relaxed))
+    {
+        return 0;
+    }
+    const uint64_t id = sNextFlow.fetch_add(1, std::memory_order_relaxed);
+    append('s', nullptr, now(), 0, id);
+    return id;
+}
+
+void traceFlowEnd(uint64_t id)
+{
+    if (id && sEnabled.load(std::memory_order_relaxed))
+    {
+        append('f', nullptr, now(), 0, id);
+    }
+}
+
+TraceScope::TraceScope(const char* name)
+    : mName(name),
+      mStart(sEnabled.load(std::memory_order_relaxed) ? now() : 0)
+{
+}
+
+TraceScope::~TraceScope()
+{
+    if (mStart)
+    {
+        append('X', mName, mStart, now() - mStart, 0);
+    }
+}
+#else
+void startTrace() {}
+
+bool stopTrace(const char* path)
+{
+    (void)path;
+    return false;
+}
+#endif
+}
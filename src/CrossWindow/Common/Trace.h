@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+
+/**
+ * Spans of the event pipeline in Chrome trace event JSON, which
+ * chrome://tracing and ui.perfetto.dev both load. Built with XWIN_TRACE the
+ * EventQueue records update(), waits, socket reads, decoding, coalescing and
+ * delivery, with a flow arrow from each event's decoding to its pop().
+ * Without it the macros compile to nothing.
+ */
+#if XWIN_TRACE
+#define XWIN_TRACE_CONCAT_(a, b) a##b
+#define XWIN_TRACE_CONCAT(a, b) XWIN_TRACE_CONCAT_(a, b)
+// Span named by a string literal, to the end of the enclosing block
+#define XWIN_TRACE_SCOPE(name)                                                 \
+    xwin::TraceScope XWIN_TRACE_CONCAT(xwinTraceScope, __LINE__)(name)
+// Starts a flow arrow in the current span, evaluates to its id
+#define XWIN_TRACE_FLOW_BEGIN() xwin::traceFlowBegin()
+// Ends the flow arrow in the current span, the id is not evaluated otherwise
+#define XWIN_TRACE_FLOW_END(id) xwin::traceFlowEnd(id)
+#else
+#define XWIN_TRACE_SCOPE(name) ((void)0)
+#define XWIN_TRACE_FLOW_BEGIN() uint64_t(0)
+#define XWIN_TRACE_FLOW_END(id) ((void)0)
+#endif
+
+namespace xwin
+{
+// Starts recording, every thread appends to a buffer of its own without locks
+void startTrace();
+
+// Stops recording and writes what was recorded since the last call to path.
+// Threads still inside a span are not waited on, their spans land in the
+// next trace. False when the file can't be written or XWIN_TRACE is off
+bool stopTrace(const char* path);
+
+#if XWIN_TRACE
+uint64_t traceFlowBegin();
+
+void traceFlowEnd(uint64_t id);
+
+class TraceScope
+{
+  public:
+    explicit TraceScope(const char* name);
+
+    ~TraceScope();
+
+  protected:
+    const char* mName;
+
+    // Zero when recording was off at the start of the span
+    uint64_t mStart;
+};
+#endif
+}
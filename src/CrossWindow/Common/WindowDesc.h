@@ -96,4 +96,19 @@ struct UVec2
         return self;
     }
 };
+
+/**
+ * A rectangle in window pixels, origin at the top left
+ */
+struct Rect
+{
+    int x;
+    int y;
+    unsigned width;
+    unsigned height;
+    Rect(int x = 0, int y = 0, unsigned width = 0, unsigned height = 0)
+        : x(x), y(y), width(width), height(height)
+    {
+    }
+};
 }
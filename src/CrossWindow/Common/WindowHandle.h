@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace xwin
+{
+/**
+ * Reference to a window living in a WindowPool. A slot's generation moves on
+ * when its window is destroyed, so stale handles stop resolving instead of
+ * dangling like a Window pointer would.
+ */
+struct WindowHandle
+{
+    uint32_t index = 0;
+
+    // Live generations are odd, a default handle is never valid
+    uint32_t generation = 0;
+
+    explicit operator bool() const { return generation != 0; }
+
+    bool operator==(const WindowHandle& other) const
+    {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator!=(const WindowHandle& other) const
+    {
+        return !(*this == other);
+    }
+};
+}
@@ -0,0 +1,55 @@
+#include "WindowPool.h"
+
+namespace xwin
+{
+WindowHandle WindowPool::insert(Window* window, uint32_t nativeId)
+{
+    uint32_t index;
+    if (!mFree.empty())
+    {
+        index = mFree.back();
+        mFree.pop_back();
+    }
+    else
+    {
+        index = static_cast<uint32_t>(mGenerations.size());
+        mGenerations.push_back(0);
+        mNativeIds.push_back(0);
+        mRects.emplace_back();
+        mFlags.push_back(0);
+        mWindows.push_back(nullptr);
+    }
+
+    ++mGenerations[index];
+    mNativeIds[index] = nativeId;
+    mRects[index] = Rect();
+    mFlags[index] = 0;
+    mWindows[index] = window;
+    mSlots[nativeId] = index;
+    ++mLive;
+    return WindowHandle{index, mGenerations[index]};
+}
+
+void WindowPool::remove(WindowHandle handle)
+{
+    if (!contains(handle))
+    {
+        return;
+    }
+    mSlots.erase(mNativeIds[handle.index]);
+    ++mGenerations[handle.index];
+    mWindows[handle.index] = nullptr;
+    mFree.push_back(handle.index);
+    --mLive;
+}
+
+WindowHandle WindowPool::find(uint32_t nativeId) const
+{
+    auto itr = mSlots.find(nativeId);
+    if (itr == mSlots.end())
+    {
+        return WindowHandle();
+    }
+    return WindowHandle{itr->second, mGenerations[itr->second]};
+}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "WindowDesc.h"
+#include "WindowHandle.h"
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace xwin
+{
+struct Window;
+
+/**
+ * The windows of one EventQueue, addressed by generational handles. What
+ * routing touches for every event, the native id, generation, geometry and
+ * flags, lives in dense arrays indexed by slot; the Window object only holds
+ * the rest and is reached through one pointer per slot. A released slot moves
+ * its generation on, so handles kept past their window's destruction resolve
+ * to null instead of dangling.
+ */
+class WindowPool
+{
+  public:
+    // Bits of flags(), kept with the geometry because routing reads them
+    enum Flag : uint8_t
+    {
+        // Inside a window manager frame, configures then report parent
+        // relative positions
+        Reparented = 1 << 0,
+
+        // A Paint was asked for and has not been queued yet
+        PaintRequested = 1 << 1,
+    };
+
+    // Takes a slot for a window created on the server as nativeId
+    WindowHandle insert(Window* window, uint32_t nativeId);
+
+    // Frees the slot, the handle and any copies of it turn invalid
+    void remove(WindowHandle handle);
+
+    // The window of a live handle, null otherwise
+    Window* get(WindowHandle handle) const
+    {
+        return contains(handle) ? mWindows[handle.index] : nullptr;
+    }
+
+    bool contains(WindowHandle handle) const
+    {
+        return handle.index < mGenerations.size() &&
+               mGenerations[handle.index] == handle.generation &&
+               (handle.generation & 1);
+    }
+
+    // Handle of the window with this native id, null if there is none
+    WindowHandle find(uint32_t nativeId) const;
+
+    // Hot state of a live handle
+    Rect& rect(WindowHandle handle) { return mRects[handle.index]; }
+
+    const Rect& rect(WindowHandle handle) const { return mRects[handle.index]; }
+
+    uint8_t& flags(WindowHandle handle) { return mFlags[handle.index]; }
+
+    uint32_t nativeId(WindowHandle handle) const
+    {
+        return mNativeIds[handle.index];
+    }
+
+    template <typename Fn> void forEach(Fn&& fn) const
+    {
+        for (uint32_t i = 0; i < mGenerations.size(); ++i)
+        {
+            if (mGenerations[i] & 1)
+            {
+                fn(WindowHandle{i, mGenerations[i]}, mWindows[i]);
+            }
+        }
+    }
+
+    uint32_t size() const { return mLive; }
+
+  protected:
+    // One entry per slot ever used, odd generations are live
+    std::vector<uint32_t> mGenerations;
+    std::vector<uint32_t> mNativeIds;
+    std::vector<Rect> mRects;
+    std::vector<uint8_t> mFlags;
+
+    // The cold rest of each window
+    std::vector<Window*> mWindows;
+
+    // Released slots, reused last in first out while they are still cached
+    std::vector<uint32_t> mFree;
+
+    // Events name windows by native id
+    std::unordered_map<uint32_t, uint32_t> mSlots;
+
+    uint32_t mLive = 0;
+};
+}
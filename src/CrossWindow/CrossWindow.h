@@ -6,4 +6,5 @@
  * A basic cross platform window/input abstraction layer.
  */
 
+#include "Common/Displays.h"
 #include "Common/Window.h"
\ No newline at end of file
@@ -1,10 +1,29 @@
 #include "../Common/Init.h"
+#include "../XCB/XCBCursors.h"
+#include "../XCB/XCBDisplays.h"
 #include "Main.h"
 
 #include <xcb/xcb.h>
 
+#if XWIN_XCB_XLIB
+#include <X11/Xlib-xcb.h>
+#endif
+
 int main(int argc, const char** argv)
 {
+#if XWIN_XCB_XLIB
+    // Xlib opens the connection so code that needs a Display shares it, but
+    // hands the event queue to XCB: events skip the copy into an XEvent and
+    // go through the same decoding as a plain XCB connection
+    Display* display = XOpenDisplay(nullptr);
+    if (!display)
+    {
+        return 1;
+    }
+    XSetEventQueueOwner(display, XCBOwnsEventQueue);
+    xcb_connection_t* connection = XGetXCBConnection(display);
+    int screenNum = DefaultScreen(display);
+#else
     int screenNum = 0;
     xcb_connection_t* connection = xcb_connect(nullptr, &screenNum);
 
@@ -12,6 +31,7 @@ int main(int argc, const char** argv)
     {
         return 1;
     }
+#endif
 
     /* Get the screen whose number is screenNum */
 
@@ -26,11 +46,30 @@ int main(int argc, const char** argv)
 
     xcb_screen_t* screen = iter.data;
 
-    xwin::init(argc, argv, connection, screen);
+#if XWIN_XCB_XLIB
+    if (!xwin::init(argc, argv, connection, screen, display))
+    {
+        XCloseDisplay(display);
+        return 1;
+    }
+#else
+    if (!xwin::init(argc, argv, connection, screen))
+    {
+        xcb_disconnect(connection);
+        return 1;
+    }
+#endif
 
     xmain(argc, argv);
 
+    xwin::release_cursors();
+    xwin::release_displays();
+#if XWIN_XCB_XLIB
+    // The connection belongs to the Display
+    XCloseDisplay(display);
+#else
     xcb_disconnect(connection);
+#endif
 
     return 0;
-}
\ No newline at end of file
+}
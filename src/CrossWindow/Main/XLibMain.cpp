@@ -1,16 +1,29 @@
 #include "../Common/Init.h"
 #include "Main.h"
 
-int main(int argc, char** argv)
+#include <X11/Xlib.h>
+
+int main(int argc, const char** argv)
 {
-    xwin::init(argc, argv);
+    XInitThreads();
+
+    // One connection for the whole process, every window and EventQueue
+    // shares it
+    Display* display = XOpenDisplay(nullptr);
+    if (!display)
+    {
+        return 1;
+    }
 
-    
+    if (!xwin::init(argc, argv, display))
+    {
+        XCloseDisplay(display);
+        return 1;
+    }
 
     xmain(argc, argv);
 
-    XDestroyWindow(display, xlib_window);
     XCloseDisplay(display);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,6 @@
+#include "../Common/Displays.h"
+
+namespace xwin
+{
+std::vector<DisplayDesc> enumerateDisplays() { return {}; }
+}
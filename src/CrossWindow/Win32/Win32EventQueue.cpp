@@ -111,7 +111,16 @@ LRESULT EventQueue::pushEvent(MSG msg, Window* window)
         rect.bottom = cyHeight;
         FillRect(ps.hdc, &rect, BorderBrush);
         EndPaint(window->m.hwnd, &ps);
-        e = xwin::Event(xwin::EventType::Paint, window);
+        xwin::PaintData paint;
+        if (!IsRectEmpty(&ps.rcPaint))
+        {
+            paint.rects[0] = xwin::Rect(
+                ps.rcPaint.left, ps.rcPaint.top,
+                static_cast<unsigned>(ps.rcPaint.right - ps.rcPaint.left),
+                static_cast<unsigned>(ps.rcPaint.bottom - ps.rcPaint.top));
+            paint.rectCount = 1;
+        }
+        e = xwin::Event(paint, window);
         break;
     }
     case WM_ERASEBKGND:
@@ -20,10 +20,15 @@ struct Window {
 	Window(Window&& rhs) noexcept;
 	Window& operator=(Window&& rhs) noexcept;
 	[[nodiscard]] auto create(const WindowDesc& desc, EventQueue& eventQueue, void* parentWindow) -> bool;
-	[[nodiscard]] auto get_client_data() -> std::any { return m.client_data; }
+	[[nodiscard]] auto get_client_data() const -> const std::any& { return m.client_data; }
+	// Application object behind the window, a single load from an event handler. Not owned, unlike client data
+	template <typename T>
+	[[nodiscard]] auto get_user() const -> T* { return static_cast<T*>(m.user_data); }
 	[[nodiscard]] auto is_valid() const -> bool { return m.hwnd != 0; }
 	auto destroy() -> void;
-	auto set_client_data(std::any data) -> void { m.client_data = data; }
+	auto set_client_data(std::any data) -> void { m.client_data = std::move(data); }
+	template <typename T>
+	auto set_user(T* data) -> void { m.user_data = data; }
 	std::string getTitle() const;
 	void setTitle(std::string title);
 	UVec2 getPosition() const;
@@ -87,6 +92,7 @@ private:
 		WNDCLASSEX wnd_class        = {0};
 		std::function<void(const xwin::Event e)> event_callback;
 		std::any client_data;
+		void* user_data             = nullptr;
 	};
 	static LRESULT CALLBACK WindowProcStatic(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam); 
 	LRESULT WindowProc(UINT msg, WPARAM wparam, LPARAM lparam); 
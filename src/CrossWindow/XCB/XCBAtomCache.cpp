@@ -0,0 +1,75 @@
+#include "XCBAtomCache.h"
+#include "../Common/RoundTrips.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace xwin {
+
+/**
+ * X11 names of each AtomId, in enum order.
+ */
+static const char* sAtomNames[static_cast<size_t>(AtomId::AtomIdMax)] = {
+	"WM_PROTOCOLS",
+	"WM_DELETE_WINDOW",
+	"UTF8_STRING",
+	"_NET_WM_NAME",
+	"_NET_WM_ICON_NAME",
+	"_NET_WM_ICON",
+	"_NET_WM_PID",
+	"_NET_WM_PING",
+	"_NET_WM_STATE",
+	"_NET_WM_STATE_FULLSCREEN",
+	"_NET_WM_STATE_MAXIMIZED_VERT",
+	"_NET_WM_STATE_MAXIMIZED_HORZ",
+	"_NET_WM_STATE_HIDDEN",
+	"_NET_WM_STATE_ABOVE",
+	"_NET_WM_SYNC_REQUEST",
+	"_NET_WM_SYNC_REQUEST_COUNTER",
+	"_NET_WM_WINDOW_TYPE",
+	"_NET_WM_WINDOW_TYPE_NORMAL",
+	"_NET_WM_WINDOW_TYPE_DIALOG",
+	"_MOTIF_WM_HINTS",
+	"CLIPBOARD",
+	"TARGETS",
+	"INCR",
+	"TEXT",
+	"XWIN_SELECTION",
+	"XdndAware",
+	"XdndEnter",
+	"XdndPosition",
+	"XdndStatus",
+	"XdndLeave",
+	"XdndDrop",
+	"XdndFinished",
+	"XdndSelection",
+	"XdndTypeList",
+	"XdndActionCopy",
+	"text/uri-list",
+};
+
+auto AtomCache::intern(xcb_connection_t* connection) -> bool {
+	constexpr size_t count = static_cast<size_t>(AtomId::AtomIdMax);
+	xcb_intern_atom_cookie_t cookies[count];
+
+	// Send every request before waiting on any reply
+	for (size_t i = 0; i < count; ++i) {
+		cookies[i] = xcb_intern_atom(connection, 0, static_cast<uint16_t>(strlen(sAtomNames[i])), sAtomNames[i]);
+	}
+
+	XWIN_ROUND_TRIP_SCOPE();
+	bool ok = true;
+	for (size_t i = 0; i < count; ++i) {
+		xcb_intern_atom_reply_t* reply = xcb_intern_atom_reply(connection, cookies[i], nullptr);
+		if (reply) {
+			mAtoms[i] = reply->atom;
+			free(reply);
+		} else {
+			mAtoms[i] = XCB_ATOM_NONE;
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+} // namespace xwin
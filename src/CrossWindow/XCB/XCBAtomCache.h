@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <xcb/xcb.h>
+
+namespace xwin {
+
+/**
+ * Atoms interned once per connection. Enumerators drop the leading
+ * underscore of the X11 name (NET_WM_NAME is "_NET_WM_NAME").
+ */
+enum class AtomId : size_t {
+	WM_PROTOCOLS = 0,
+	WM_DELETE_WINDOW,
+	UTF8_STRING,
+	NET_WM_NAME,
+	NET_WM_ICON_NAME,
+	NET_WM_ICON,
+	NET_WM_PID,
+	NET_WM_PING,
+	NET_WM_STATE,
+	NET_WM_STATE_FULLSCREEN,
+	NET_WM_STATE_MAXIMIZED_VERT,
+	NET_WM_STATE_MAXIMIZED_HORZ,
+	NET_WM_STATE_HIDDEN,
+	NET_WM_STATE_ABOVE,
+	NET_WM_SYNC_REQUEST,
+	NET_WM_SYNC_REQUEST_COUNTER,
+	NET_WM_WINDOW_TYPE,
+	NET_WM_WINDOW_TYPE_NORMAL,
+	NET_WM_WINDOW_TYPE_DIALOG,
+	MOTIF_WM_HINTS,
+	CLIPBOARD,
+	TARGETS,
+	INCR,
+	TEXT,
+	// Property our selection conversions are delivered to
+	XWIN_SELECTION,
+	// Drag and drop, XDND_AWARE is "XdndAware"
+	XDND_AWARE,
+	XDND_ENTER,
+	XDND_POSITION,
+	XDND_STATUS,
+	XDND_LEAVE,
+	XDND_DROP,
+	XDND_FINISHED,
+	XDND_SELECTION,
+	XDND_TYPE_LIST,
+	XDND_ACTION_COPY,
+	// "text/uri-list"
+	TEXT_URI_LIST,
+	AtomIdMax
+};
+
+/**
+ * Interns every AtomId in a single pipelined burst, one round trip in total
+ * rather than one per atom, then serves them as array lookups.
+ */
+class AtomCache {
+public:
+	auto intern(xcb_connection_t* connection) -> bool;
+	[[nodiscard]] auto get(AtomId id) const -> xcb_atom_t { return mAtoms[static_cast<size_t>(id)]; }
+	[[nodiscard]] auto operator[](AtomId id) const -> xcb_atom_t { return get(id); }
+protected:
+	xcb_atom_t mAtoms[static_cast<size_t>(AtomId::AtomIdMax)] = {};
+};
+
+} // namespace xwin
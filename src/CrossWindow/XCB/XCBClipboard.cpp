@@ -0,0 +1,345 @@
+#include "XCBClipboard.h"
+#include "../Common/Counters.h"
+#include "../Common/Init.h"
+#include "../Common/RoundTrips.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+namespace xwin {
+
+namespace {
+
+// Cap on a single property write, keeps one paste from stalling the server
+constexpr size_t kMaxChunkBytes = 256 * 1024;
+
+// Room left in a request for the ChangeProperty header
+constexpr size_t kChangePropertyHeaderBytes = 64;
+
+constexpr size_t kNoSelection = static_cast<size_t>(Selection::SelectionMax);
+
+} // namespace
+
+auto Clipboard::init(xcb_connection_t* connection, xcb_screen_t* screen, Requests* requests) -> void {
+	const AtomCache& atoms = getXWinState().atoms;
+	mConnection = connection;
+	mRequests = requests;
+
+	// Replies to our conversions are written to this window, and owners
+	// stream INCR data to it as we delete each chunk
+	mWindow = xcb_generate_id(connection);
+	const uint32_t eventMask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+	xcb_create_window(connection, XCB_COPY_FROM_PARENT, mWindow, screen->root, 0, 0, 1, 1, 0, XCB_WINDOW_CLASS_INPUT_ONLY, XCB_COPY_FROM_PARENT, XCB_CW_EVENT_MASK, &eventMask);
+
+	mChunkSize = std::min(getXWinState().extensions.maxRequestBytes - kChangePropertyHeaderBytes, kMaxChunkBytes);
+
+	// Targets every text copy offers, spared a round trip each
+	mAtoms["UTF8_STRING"] = atoms[AtomId::UTF8_STRING];
+	mAtoms["TEXT"] = atoms[AtomId::TEXT];
+	mAtoms["TARGETS"] = atoms[AtomId::TARGETS];
+	mAtoms["STRING"] = XCB_ATOM_STRING;
+}
+
+auto Clipboard::release() -> void {
+	if (mConnection == nullptr) {
+		return;
+	}
+	// Requests drops the outstanding read along with its handler
+	mReadPending = false;
+	// Destroying the window gives up any selection it owns
+	xcb_destroy_window(mConnection, mWindow);
+	for (Owned& owned : mOwned) {
+		owned = Owned();
+	}
+	mOutgoing.clear();
+	mIncoming.clear();
+	mReadState = ReadState::Idle;
+	mWindow = 0;
+	mConnection = nullptr;
+}
+
+auto Clipboard::request(Selection selection, const std::string& target, Sink sink) -> void {
+	convert(selection_atom(selection), atom(target), XCB_CURRENT_TIME, std::move(sink));
+}
+
+auto Clipboard::convert(xcb_atom_t selection, xcb_atom_t target, xcb_timestamp_t time, Sink sink) -> void {
+	mIncoming.push_back({selection, target, time, std::move(sink)});
+	if (mReadState == ReadState::Idle) {
+		start_next();
+	}
+}
+
+auto Clipboard::set(Selection selection, std::vector<uint8_t> data, const std::vector<std::string>& targets) -> void {
+	Owned& owned = mOwned[static_cast<size_t>(selection)];
+	// Transfers of the previous contents still in flight keep their own reference
+	owned.data = std::make_shared<const std::vector<uint8_t>>(std::move(data));
+	owned.targets.clear();
+	for (const std::string& target : targets) {
+		owned.targets.push_back(atom(target));
+	}
+	xcb_set_selection_owner(mConnection, mWindow, selection_atom(selection), XCB_CURRENT_TIME);
+	xcb_flush(mConnection);
+	count(Counter::Flushes);
+}
+
+auto Clipboard::set_text(Selection selection, const std::string& text) -> void {
+	set(selection, std::vector<uint8_t>(text.begin(), text.end()), {"UTF8_STRING", "TEXT", "text/plain;charset=utf-8"});
+}
+
+auto Clipboard::clear(Selection selection) -> void {
+	Owned& owned = mOwned[static_cast<size_t>(selection)];
+	if (owned.data == nullptr) {
+		return;
+	}
+	owned = Owned();
+	xcb_set_selection_owner(mConnection, XCB_NONE, selection_atom(selection), XCB_CURRENT_TIME);
+	xcb_flush(mConnection);
+	count(Counter::Flushes);
+}
+
+auto Clipboard::start_next() -> void {
+	const AtomCache& atoms = getXWinState().atoms;
+	while (mReadState == ReadState::Idle && !mIncoming.empty()) {
+		const Incoming& incoming = mIncoming.front();
+		const size_t index = selection_index(incoming.selection);
+		if (index == kNoSelection || mOwned[index].data == nullptr) {
+			xcb_convert_selection(mConnection, mWindow, incoming.selection, incoming.target, atoms[AtomId::XWIN_SELECTION], incoming.time);
+			xcb_flush(mConnection);
+			count(Counter::Flushes);
+			mReadState = ReadState::Converting;
+			return;
+		}
+
+		// Pasting our own copy, answer it without the server
+		const Owned& owned = mOwned[index];
+		std::shared_ptr<const std::vector<uint8_t>> data;
+		if (incoming.target == atoms[AtomId::TARGETS]) {
+			std::vector<xcb_atom_t> targets = owned.targets;
+			targets.insert(targets.begin(), atoms[AtomId::TARGETS]);
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(targets.data());
+			data = std::make_shared<const std::vector<uint8_t>>(bytes, bytes + targets.size() * sizeof(xcb_atom_t));
+		} else if (std::find(owned.targets.begin(), owned.targets.end(), incoming.target) != owned.targets.end()) {
+			data = owned.data;
+		}
+
+		Sink sink = std::move(mIncoming.front().sink);
+		mIncoming.pop_front();
+		if (data == nullptr) {
+			sink(Status::Failed, nullptr, 0);
+			continue;
+		}
+		if (!data->empty()) {
+			sink(Status::Data, data->data(), data->size());
+		}
+		sink(Status::Done, nullptr, 0);
+	}
+}
+
+auto Clipboard::read_property(uint32_t offset) -> void {
+	// Deleting on the read that reaches the end tells an INCR owner to send
+	// the next chunk, and leaves the property clear for the next conversion
+	mReadOffset = offset;
+	const xcb_get_property_cookie_t cookie = xcb_get_property(mConnection, 1, mWindow, getXWinState().atoms[AtomId::XWIN_SELECTION], XCB_GET_PROPERTY_TYPE_ANY, offset, static_cast<uint32_t>(mChunkSize / 4));
+	mReadPending = true;
+	mRequests->on_reply<xcb_get_property_reply_t>(cookie, [this](xcb_get_property_reply_t* reply, xcb_generic_error_t*) {
+		mReadPending = false;
+		if (reply == nullptr) {
+			finish(Status::Failed);
+			return;
+		}
+		on_property_reply(reply);
+	});
+	xcb_flush(mConnection);
+	count(Counter::Flushes);
+}
+
+auto Clipboard::on_property_reply(xcb_get_property_reply_t* reply) -> void {
+	if (reply->type == XCB_ATOM_NONE) {
+		finish(Status::Failed);
+		return;
+	}
+	if (mReadState == ReadState::Reading && reply->type == getXWinState().atoms[AtomId::INCR]) {
+		// The read deleted the INCR marker, which starts the transfer
+		mReadState = ReadState::Incremental;
+		read_ready_chunk();
+		return;
+	}
+
+	const uint8_t* value = static_cast<const uint8_t*>(xcb_get_property_value(reply));
+	const size_t length = static_cast<size_t>(xcb_get_property_value_length(reply));
+	if (mReadState == ReadState::Incremental && length == 0 && reply->bytes_after == 0 && mReadOffset == 0) {
+		// A zero length chunk ends an INCR transfer
+		finish(Status::Done);
+		return;
+	}
+	if (length > 0) {
+		mIncoming.front().sink(Status::Data, value, length);
+	}
+	if (reply->bytes_after > 0) {
+		read_property(mReadOffset + static_cast<uint32_t>(length / 4));
+	} else if (mReadState == ReadState::Reading) {
+		finish(Status::Done);
+	} else {
+		// The owner writes the next INCR chunk and notifies us
+		read_ready_chunk();
+	}
+}
+
+auto Clipboard::read_ready_chunk() -> void {
+	if (mChunkReady) {
+		mChunkReady = false;
+		read_property(0);
+	}
+}
+
+auto Clipboard::finish(Status status) -> void {
+	Sink sink = std::move(mIncoming.front().sink);
+	mIncoming.pop_front();
+	mReadState = ReadState::Idle;
+	sink(status, nullptr, 0);
+	// The sink may have queued and started another request itself
+	if (mReadState == ReadState::Idle) {
+		start_next();
+	}
+}
+
+auto Clipboard::on_selection_notify(const xcb_selection_notify_event_t* event) -> void {
+	if (mReadState != ReadState::Converting || event->requestor != mWindow) {
+		return;
+	}
+	if (event->property == XCB_ATOM_NONE) {
+		finish(Status::Failed);
+		return;
+	}
+	mReadState = ReadState::Reading;
+	mChunkReady = false;
+	read_property(0);
+}
+
+auto Clipboard::on_selection_request(const xcb_selection_request_event_t* event) -> void {
+	const AtomCache& atoms = getXWinState().atoms;
+	const size_t index = selection_index(event->selection);
+
+	// Obsolete clients leave the property for us to choose
+	xcb_atom_t property = event->property == XCB_ATOM_NONE ? event->target : event->property;
+	if (index == kNoSelection || mOwned[index].data == nullptr) {
+		property = XCB_ATOM_NONE;
+	} else if (event->target == atoms[AtomId::TARGETS]) {
+		const Owned& owned = mOwned[index];
+		std::vector<xcb_atom_t> targets = owned.targets;
+		targets.insert(targets.begin(), atoms[AtomId::TARGETS]);
+		xcb_change_property(mConnection, XCB_PROP_MODE_REPLACE, event->requestor, property, XCB_ATOM_ATOM, 32, static_cast<uint32_t>(targets.size()), targets.data());
+	} else if (std::find(mOwned[index].targets.begin(), mOwned[index].targets.end(), event->target) != mOwned[index].targets.end()) {
+		const std::shared_ptr<const std::vector<uint8_t>>& data = mOwned[index].data;
+		// TEXT lets us pick the encoding, it is always UTF-8 here
+		const xcb_atom_t type = event->target == atoms[AtomId::TEXT] ? atoms[AtomId::UTF8_STRING] : event->target;
+		if (data->size() <= mChunkSize) {
+			xcb_change_property(mConnection, XCB_PROP_MODE_REPLACE, event->requestor, property, type, 8, static_cast<uint32_t>(data->size()), data->data());
+		} else {
+			// Too big for one request, announce the size and hand it over one
+			// chunk per deletion of the property
+			const uint32_t eventMask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+			xcb_change_window_attributes(mConnection, event->requestor, XCB_CW_EVENT_MASK, &eventMask);
+			const uint32_t size = static_cast<uint32_t>(data->size());
+			xcb_change_property(mConnection, XCB_PROP_MODE_REPLACE, event->requestor, property, atoms[AtomId::INCR], 32, 1, &size);
+
+			// A requestor that went away mid transfer reuses nothing of the old one
+			mOutgoing.erase(std::remove_if(mOutgoing.begin(), mOutgoing.end(), [&](const Outgoing& outgoing) {
+				return outgoing.requestor == event->requestor && outgoing.property == property;
+			}), mOutgoing.end());
+			mOutgoing.push_back({event->requestor, property, type, data, 0});
+		}
+	} else {
+		property = XCB_ATOM_NONE;
+	}
+
+	xcb_selection_notify_event_t notify = {};
+	notify.response_type = XCB_SELECTION_NOTIFY;
+	notify.time = event->time;
+	notify.requestor = event->requestor;
+	notify.selection = event->selection;
+	notify.target = event->target;
+	notify.property = property;
+	xcb_send_event(mConnection, 0, event->requestor, XCB_EVENT_MASK_NO_EVENT, reinterpret_cast<const char*>(&notify));
+	xcb_flush(mConnection);
+	count(Counter::Flushes);
+}
+
+auto Clipboard::on_selection_clear(const xcb_selection_clear_event_t* event) -> void {
+	const size_t index = selection_index(event->selection);
+	if (index != kNoSelection && event->owner == mWindow) {
+		mOwned[index] = Owned();
+	}
+}
+
+auto Clipboard::on_property_notify(const xcb_property_notify_event_t* event) -> bool {
+	if (event->window == mWindow) {
+		if (event->state != XCB_PROPERTY_NEW_VALUE || event->atom != getXWinState().atoms[AtomId::XWIN_SELECTION]) {
+			return true;
+		}
+		if (mReadState == ReadState::Incremental && !mReadPending) {
+			read_property(0);
+		} else if (mReadState == ReadState::Reading || mReadState == ReadState::Incremental) {
+			// Events are read ahead of the reply that deleted the last chunk
+			mChunkReady = true;
+		}
+		return true;
+	}
+	if (event->state != XCB_PROPERTY_DELETE) {
+		return false;
+	}
+
+	// The requestor consumed the last chunk of one of our INCR transfers
+	for (auto outgoing = mOutgoing.begin(); outgoing != mOutgoing.end(); ++outgoing) {
+		if (outgoing->requestor != event->window || outgoing->property != event->atom) {
+			continue;
+		}
+		const size_t size = std::min(outgoing->data->size() - outgoing->offset, mChunkSize);
+		xcb_change_property(mConnection, XCB_PROP_MODE_REPLACE, outgoing->requestor, outgoing->property, outgoing->type, 8, static_cast<uint32_t>(size), outgoing->data->data() + outgoing->offset);
+		if (size == 0) {
+			// The zero length chunk just written ends the transfer
+			const uint32_t eventMask = XCB_EVENT_MASK_NO_EVENT;
+			xcb_change_window_attributes(mConnection, outgoing->requestor, XCB_CW_EVENT_MASK, &eventMask);
+			mOutgoing.erase(outgoing);
+		} else {
+			outgoing->offset += size;
+		}
+		xcb_flush(mConnection);
+		count(Counter::Flushes);
+		return true;
+	}
+	return false;
+}
+
+auto Clipboard::selection_atom(Selection selection) const -> xcb_atom_t {
+	return selection == Selection::Primary ? static_cast<xcb_atom_t>(XCB_ATOM_PRIMARY) : getXWinState().atoms[AtomId::CLIPBOARD];
+}
+
+auto Clipboard::selection_index(xcb_atom_t atom) const -> size_t {
+	if (atom == XCB_ATOM_PRIMARY) {
+		return static_cast<size_t>(Selection::Primary);
+	}
+	if (atom == getXWinState().atoms[AtomId::CLIPBOARD]) {
+		return static_cast<size_t>(Selection::Clipboard);
+	}
+	return kNoSelection;
+}
+
+auto Clipboard::atom(const std::string& name) -> xcb_atom_t {
+	auto found = mAtoms.find(name);
+	if (found != mAtoms.end()) {
+		return found->second;
+	}
+	// Only the first use of a target waits on the server
+	XWIN_ROUND_TRIP_SCOPE();
+	xcb_intern_atom_reply_t* reply = xcb_intern_atom_reply(mConnection, xcb_intern_atom(mConnection, 0, static_cast<uint16_t>(name.size()), name.c_str()), nullptr);
+	xcb_atom_t result = XCB_ATOM_NONE;
+	if (reply) {
+		result = reply->atom;
+		free(reply);
+	}
+	mAtoms[name] = result;
+	return result;
+}
+
+} // namespace xwin
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "XCBRequests.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <xcb/xcb.h>
+
+namespace xwin {
+
+enum class Selection : size_t {
+	Clipboard = 0,
+	Primary,
+	SelectionMax
+};
+
+/**
+ * CLIPBOARD and PRIMARY selections over ICCCM, with INCR transfers for data
+ * that does not fit one request. Pastes stream into the caller's sink chunk by
+ * chunk as replies arrive during EventQueue::update(), never waiting on the
+ * owner, and copies are served from a shared buffer that stays alive for
+ * transfers still in flight after the next copy.
+ */
+class Clipboard {
+public:
+	enum class Status {
+		// A chunk of the data, more may follow
+		Data,
+		// The transfer finished, no data
+		Done,
+		// The owner refused the target or went away, no data
+		Failed
+	};
+	using Sink = std::function<void(Status status, const uint8_t* data, size_t size)>;
+
+	// Asks the owner of selection for its contents converted to target, such as
+	// "UTF8_STRING" or "text/plain;charset=utf-8". Requests are served in order
+	auto request(Selection selection, const std::string& target, Sink sink) -> void;
+	// Takes ownership of selection, offering data under each of targets
+	auto set(Selection selection, std::vector<uint8_t> data, const std::vector<std::string>& targets) -> void;
+	// Offers UTF-8 text under the targets text widgets ask for
+	auto set_text(Selection selection, const std::string& text) -> void;
+	auto clear(Selection selection) -> void;
+	[[nodiscard]] auto owns(Selection selection) const -> bool { return mOwned[static_cast<size_t>(selection)].data != nullptr; }
+protected:
+	struct Owned {
+		std::shared_ptr<const std::vector<uint8_t>> data;
+		std::vector<xcb_atom_t> targets;
+	};
+	struct Incoming {
+		xcb_atom_t selection;
+		xcb_atom_t target;
+		xcb_timestamp_t time;
+		Sink sink;
+	};
+	struct Outgoing {
+		xcb_window_t requestor;
+		xcb_atom_t property;
+		xcb_atom_t type;
+		std::shared_ptr<const std::vector<uint8_t>> data;
+		size_t offset;
+	};
+	enum class ReadState {
+		Idle,
+		// ConvertSelection sent, waiting on SelectionNotify
+		Converting,
+		// Reading a property written in one piece
+		Reading,
+		// The owner writes chunks as we delete them
+		Incremental
+	};
+
+	// Queues a conversion of any selection, such as XdndSelection at the time of a drop
+	auto convert(xcb_atom_t selection, xcb_atom_t target, xcb_timestamp_t time, Sink sink) -> void;
+	auto init(xcb_connection_t* connection, xcb_screen_t* screen, Requests* requests) -> void;
+	auto release() -> void;
+	// Event routing from the EventQueue
+	auto on_selection_notify(const xcb_selection_notify_event_t* event) -> void;
+	auto on_selection_request(const xcb_selection_request_event_t* event) -> void;
+	auto on_selection_clear(const xcb_selection_clear_event_t* event) -> void;
+	// Returns false for property changes that are not part of a transfer
+	auto on_property_notify(const xcb_property_notify_event_t* event) -> bool;
+
+	auto start_next() -> void;
+	auto read_property(uint32_t offset) -> void;
+	auto on_property_reply(xcb_get_property_reply_t* reply) -> void;
+	// Reads an INCR chunk whose notification came in before the last reply
+	auto read_ready_chunk() -> void;
+	auto finish(Status status) -> void;
+	[[nodiscard]] auto selection_atom(Selection selection) const -> xcb_atom_t;
+	[[nodiscard]] auto selection_index(xcb_atom_t atom) const -> size_t;
+	// Atoms for caller supplied targets, interned once then cached
+	[[nodiscard]] auto atom(const std::string& name) -> xcb_atom_t;
+
+	xcb_connection_t* mConnection = nullptr;
+	Requests* mRequests = nullptr;
+	// Unmapped window that owns our selections and receives conversions
+	xcb_window_t mWindow = 0;
+	// Largest property written in one request, bigger data goes INCR
+	size_t mChunkSize = 0;
+	Owned mOwned[static_cast<size_t>(Selection::SelectionMax)];
+	std::vector<Outgoing> mOutgoing;
+	std::deque<Incoming> mIncoming;
+	ReadState mReadState = ReadState::Idle;
+	bool mReadPending = false;
+	uint32_t mReadOffset = 0;
+	// The owner wrote an INCR chunk while the previous read was outstanding
+	bool mChunkReady = false;
+	std::unordered_map<std::string, xcb_atom_t> mAtoms;
+	friend class EventQueue;
+	friend class DragDrop;
+};
+
+} // namespace xwin
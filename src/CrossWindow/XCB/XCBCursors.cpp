@@ -0,0 +1,215 @@
+#include "XCBCursors.h"
+#include "../Common/Init.h"
+#include "../Common/PixelConvert.h"
+#include "../Common/RoundTrips.h"
+
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+#if XWIN_XCB_RENDER
+#include <xcb/render.h>
+#endif
+#if XWIN_XCB_CURSOR
+#include <xcb/xcb_cursor.h>
+#endif
+
+namespace xwin {
+
+namespace {
+
+// Cursor theme names (freedesktop cursor spec) and the core cursor font
+// glyph standing in for each when no theme can be loaded
+struct ShapeSource {
+	const char* name;
+	uint16_t glyph;
+};
+
+const ShapeSource sShapeSources[static_cast<size_t>(CursorShape::CursorShapeMax)] = {
+	{"default", 68},	 // XC_left_ptr
+	{"text", 152},		 // XC_xterm
+	{"pointer", 60},	 // XC_hand2
+	{"crosshair", 34},	 // XC_crosshair
+	{"wait", 150},		 // XC_watch
+	{"ew-resize", 108},	 // XC_sb_h_double_arrow
+	{"ns-resize", 116},	 // XC_sb_v_double_arrow
+	{"nwse-resize", 14}, // XC_bottom_right_corner
+	{"nesw-resize", 12}, // XC_bottom_left_corner
+	{"move", 52},		 // XC_fleur
+	{"not-allowed", 0},	 // XC_X_cursor
+};
+
+struct CursorCache {
+	xcb_cursor_t shapes[static_cast<size_t>(CursorShape::CursorShapeMax)] = {};
+	std::unordered_map<uint64_t, xcb_cursor_t> images;
+	xcb_cursor_t blank = XCB_CURSOR_NONE;
+	xcb_font_t font = XCB_NONE;
+#if XWIN_XCB_CURSOR
+	xcb_cursor_context_t* context = nullptr;
+	bool contextTried = false;
+#endif
+};
+
+CursorCache sCursors;
+
+#if XWIN_XCB_RENDER
+
+// FNV-1a over the pixels and geometry, the key of an image cursor
+auto hash_image(const uint32_t* rgba, unsigned width, unsigned height, unsigned hotX, unsigned hotY) -> uint64_t {
+	uint64_t hash = 14695981039346656037ull;
+	const auto mix = [&hash](const void* data, size_t size) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+	const uint32_t geometry[] = {width, height, hotX, hotY};
+	mix(geometry, sizeof(geometry));
+	mix(rgba, static_cast<size_t>(width) * height * sizeof(uint32_t));
+	return hash;
+}
+
+#endif
+
+auto glyph_cursor(xcb_connection_t* connection, uint16_t glyph) -> xcb_cursor_t {
+	if (sCursors.font == XCB_NONE) {
+		sCursors.font = xcb_generate_id(connection);
+		xcb_open_font(connection, sCursors.font, static_cast<uint16_t>(strlen("cursor")), "cursor");
+	}
+	// Each glyph's mask is the one after it, black on white
+	const xcb_cursor_t cursor = xcb_generate_id(connection);
+	xcb_create_glyph_cursor(connection, cursor, sCursors.font, sCursors.font, glyph, static_cast<uint16_t>(glyph + 1), 0, 0,
+							0, 0xffff, 0xffff, 0xffff);
+	return cursor;
+}
+
+} // namespace
+
+auto shape_cursor(CursorShape shape) -> xcb_cursor_t {
+	const size_t index = static_cast<size_t>(shape);
+	if (index >= static_cast<size_t>(CursorShape::CursorShapeMax)) {
+		return XCB_CURSOR_NONE;
+	}
+	xcb_cursor_t& cursor = sCursors.shapes[index];
+	if (cursor != XCB_CURSOR_NONE) {
+		return cursor;
+	}
+
+	const XWinState& xwinState = getXWinState();
+#if XWIN_XCB_CURSOR
+	// Reading the theme settings takes a few round trips, once per connection
+	if (!sCursors.contextTried) {
+		sCursors.contextTried = true;
+		XWIN_ROUND_TRIP_SCOPE();
+		if (xcb_cursor_context_new(xwinState.connection, xwinState.screen, &sCursors.context) < 0) {
+			sCursors.context = nullptr;
+		}
+	}
+	if (sCursors.context) {
+		cursor = xcb_cursor_load_cursor(sCursors.context, sShapeSources[index].name);
+	}
+#endif
+	if (cursor == XCB_CURSOR_NONE) {
+		cursor = glyph_cursor(xwinState.connection, sShapeSources[index].glyph);
+	}
+	return cursor;
+}
+
+auto image_cursor(const uint32_t* rgba, unsigned width, unsigned height, unsigned hotX, unsigned hotY) -> xcb_cursor_t {
+#if XWIN_XCB_RENDER
+	const XWinState& xwinState = getXWinState();
+	const uint32_t format = xwinState.extensions.renderArgbFormat;
+	xcb_connection_t* connection = xwinState.connection;
+	const size_t count = static_cast<size_t>(width) * height;
+	if (!format || count == 0 || width > 0xffff || height > 0xffff || count * 4 + 64 > xwinState.extensions.maxRequestBytes) {
+		return XCB_CURSOR_NONE;
+	}
+
+	const uint64_t key = hash_image(rgba, width, height, hotX, hotY);
+	auto found = sCursors.images.find(key);
+	if (found != sCursors.images.end()) {
+		return found->second;
+	}
+
+	// RENDER cursors are premultiplied ARGB
+	std::vector<uint32_t> pixels(count);
+	pixel::swapRedBlue(pixels.data(), rgba, count);
+	pixel::premultiply(pixels.data(), pixels.data(), count);
+
+	const uint16_t w = static_cast<uint16_t>(width);
+	const uint16_t h = static_cast<uint16_t>(height);
+	const xcb_pixmap_t pixmap = xcb_generate_id(connection);
+	xcb_create_pixmap(connection, 32, pixmap, xwinState.screen->root, w, h);
+	const xcb_gcontext_t gc = xcb_generate_id(connection);
+	xcb_create_gc(connection, gc, pixmap, 0, nullptr);
+	xcb_put_image(connection, XCB_IMAGE_FORMAT_Z_PIXMAP, pixmap, gc, w, h, 0, 0, 0, 32, static_cast<uint32_t>(count * 4),
+				  reinterpret_cast<const uint8_t*>(pixels.data()));
+
+	const xcb_render_picture_t picture = xcb_generate_id(connection);
+	xcb_render_create_picture(connection, picture, pixmap, format, 0, nullptr);
+	const xcb_cursor_t cursor = xcb_generate_id(connection);
+	xcb_render_create_cursor(connection, cursor, picture, static_cast<uint16_t>(hotX), static_cast<uint16_t>(hotY));
+
+	// The cursor keeps its own copy of the image
+	xcb_render_free_picture(connection, picture);
+	xcb_free_gc(connection, gc);
+	xcb_free_pixmap(connection, pixmap);
+
+	sCursors.images.emplace(key, cursor);
+	return cursor;
+#else
+	(void)rgba;
+	(void)width;
+	(void)height;
+	(void)hotX;
+	(void)hotY;
+	return XCB_CURSOR_NONE;
+#endif
+}
+
+auto blank_cursor() -> xcb_cursor_t {
+	if (sCursors.blank != XCB_CURSOR_NONE) {
+		return sCursors.blank;
+	}
+	// A 1x1 cursor whose mask is all zero, the new pixmap's contents do not matter
+	const XWinState& xwinState = getXWinState();
+	xcb_connection_t* connection = xwinState.connection;
+	const xcb_pixmap_t pixmap = xcb_generate_id(connection);
+	xcb_create_pixmap(connection, 1, pixmap, xwinState.screen->root, 1, 1);
+	const xcb_gcontext_t gc = xcb_generate_id(connection);
+	const uint32_t foreground = 0;
+	xcb_create_gc(connection, gc, pixmap, XCB_GC_FOREGROUND, &foreground);
+	const xcb_rectangle_t pixel = {0, 0, 1, 1};
+	xcb_poly_fill_rectangle(connection, pixmap, gc, 1, &pixel);
+	sCursors.blank = xcb_generate_id(connection);
+	xcb_create_cursor(connection, sCursors.blank, pixmap, pixmap, 0, 0, 0, 0, 0, 0, 0, 0);
+	xcb_free_gc(connection, gc);
+	xcb_free_pixmap(connection, pixmap);
+	return sCursors.blank;
+}
+
+auto release_cursors() -> void {
+	xcb_connection_t* connection = getXWinState().connection;
+	for (xcb_cursor_t& cursor : sCursors.shapes) {
+		if (cursor != XCB_CURSOR_NONE) {
+			xcb_free_cursor(connection, cursor);
+		}
+	}
+	for (auto& image : sCursors.images) {
+		xcb_free_cursor(connection, image.second);
+	}
+	if (sCursors.blank != XCB_CURSOR_NONE) {
+		xcb_free_cursor(connection, sCursors.blank);
+	}
+	if (sCursors.font != XCB_NONE) {
+		xcb_close_font(connection, sCursors.font);
+	}
+#if XWIN_XCB_CURSOR
+	if (sCursors.context) {
+		xcb_cursor_context_free(sCursors.context);
+	}
+#endif
+	sCursors = CursorCache();
+}
+
+} // namespace xwin
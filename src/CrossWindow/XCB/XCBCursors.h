@@ -0,0 +1,27 @@
+#pragma once
+
+#include "../Common/CursorDesc.h"
+
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+namespace xwin {
+
+/**
+ * Cursors are server resources shared by every window, so each one is
+ * created once per connection and kept until release_cursors(). Windows
+ * switch between them with a single ChangeWindowAttributes.
+ */
+
+// Cursor of a standard shape from the user's cursor theme, or the core
+// cursor font without xcb-cursor, loaded on first use
+[[nodiscard]] auto shape_cursor(CursorShape shape) -> xcb_cursor_t;
+// Cursor from RGBA pixels in memory order, cached by content so animations
+// cycling through frames upload each one once. XCB_CURSOR_NONE without RENDER
+[[nodiscard]] auto image_cursor(const uint32_t* rgba, unsigned width, unsigned height, unsigned hotX, unsigned hotY) -> xcb_cursor_t;
+// Fully transparent cursor, hides the pointer when XFixes is unavailable
+[[nodiscard]] auto blank_cursor() -> xcb_cursor_t;
+// Frees every cached cursor, call before disconnecting
+auto release_cursors() -> void;
+
+} // namespace xwin
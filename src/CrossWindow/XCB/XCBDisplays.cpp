@@ -0,0 +1,378 @@
+#include "XCBDisplays.h"
+#include "../Common/Displays.h"
+#include "XCBDpi.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdlib.h>
+#include <string.h>
+
+#if XWIN_XCB_RANDR
+#include <xcb/randr.h>
+#endif
+
+namespace xwin {
+
+namespace {
+
+std::atomic<const DisplaySnapshot*> sCurrent{nullptr};
+
+// CurrentDisplays alive on any thread
+std::atomic<unsigned> sReaders{0};
+
+// The snapshot in sCurrent, and the ones it replaced while readers were
+// active. Only the thread running the event loop touches these
+std::unique_ptr<DisplaySnapshot> sPublished;
+std::vector<std::unique_ptr<DisplaySnapshot>> sRetired;
+
+const DisplaySnapshot sEmpty;
+
+// Xft.dpi as of the last refresh
+DpiCache sDpi;
+
+auto same_displays(const std::vector<DisplayDesc>& a, const std::vector<DisplayDesc>& b) -> bool {
+	return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const DisplayDesc& l, const DisplayDesc& r) {
+		return l.name == r.name && l.x == r.x && l.y == r.y && l.width == r.width && l.height == r.height &&
+			   l.widthMillimeters == r.widthMillimeters && l.heightMillimeters == r.heightMillimeters &&
+			   l.refreshRate == r.refreshRate && l.scale == r.scale && l.primary == r.primary;
+	});
+}
+
+// Frees replaced snapshots if nobody reads. A reader counted after this check
+// loaded sCurrent after it was swapped, so it cannot hold a retired snapshot
+auto free_retired() -> void {
+	if (!sRetired.empty() && sReaders.load(std::memory_order_seq_cst) == 0) {
+		sRetired.clear();
+	}
+}
+
+// Requests frees replies once their handler returns, this keeps one longer
+template <typename Reply>
+auto copy_reply(const Reply* reply) -> Reply* {
+	if (!reply) {
+		return nullptr;
+	}
+	// 32 bytes and length more words
+	const size_t size = 32 + reinterpret_cast<const xcb_generic_reply_t*>(reply)->length * size_t(4);
+	void* copy = malloc(size);
+	memcpy(copy, reply, size);
+	return static_cast<Reply*>(copy);
+}
+
+#if XWIN_XCB_RANDR
+
+auto refresh_rate(const xcb_randr_mode_info_t& mode) -> double {
+	if (mode.htotal == 0 || mode.vtotal == 0) {
+		return 0.0;
+	}
+	double lines = mode.vtotal;
+	if (mode.mode_flags & XCB_RANDR_MODE_FLAG_DOUBLE_SCAN) {
+		lines *= 2.0;
+	}
+	if (mode.mode_flags & XCB_RANDR_MODE_FLAG_INTERLACE) {
+		lines /= 2.0;
+	}
+	return mode.dot_clock / (mode.htotal * lines);
+}
+
+/**
+ * The CRTC and output state both display paths need, copied out of the
+ * replies of one burst and freed together
+ */
+struct RandrState {
+	xcb_randr_get_screen_resources_current_reply_t* resources = nullptr;
+	std::vector<xcb_randr_get_crtc_info_reply_t*> crtcs;
+	std::vector<xcb_randr_get_output_info_reply_t*> outputs;
+
+	~RandrState() {
+		for (xcb_randr_get_crtc_info_reply_t* crtc : crtcs) {
+			free(crtc);
+		}
+		for (xcb_randr_get_output_info_reply_t* output : outputs) {
+			free(output);
+		}
+		free(resources);
+	}
+
+	[[nodiscard]] auto crtc(xcb_randr_crtc_t id) const -> const xcb_randr_get_crtc_info_reply_t* {
+		const xcb_randr_crtc_t* ids = xcb_randr_get_screen_resources_current_crtcs(resources);
+		for (size_t i = 0; i < crtcs.size(); ++i) {
+			if (ids[i] == id) {
+				return crtcs[i];
+			}
+		}
+		return nullptr;
+	}
+
+	[[nodiscard]] auto output(xcb_randr_output_t id) const -> const xcb_randr_get_output_info_reply_t* {
+		const xcb_randr_output_t* ids = xcb_randr_get_screen_resources_current_outputs(resources);
+		for (size_t i = 0; i < outputs.size(); ++i) {
+			if (ids[i] == id) {
+				return outputs[i];
+			}
+		}
+		return nullptr;
+	}
+
+	// Fills the name and refresh rate of a display shown through output
+	auto describe(xcb_randr_output_t id, DisplayDesc& display) const -> void {
+		const xcb_randr_get_output_info_reply_t* info = output(id);
+		if (!info) {
+			return;
+		}
+		display.name.assign(reinterpret_cast<const char*>(xcb_randr_get_output_info_name(info)),
+							static_cast<size_t>(xcb_randr_get_output_info_name_length(info)));
+		const xcb_randr_get_crtc_info_reply_t* crtcInfo = crtc(info->crtc);
+		if (!crtcInfo || !crtcInfo->mode) {
+			return;
+		}
+		const xcb_randr_mode_info_t* modes = xcb_randr_get_screen_resources_current_modes(resources);
+		const int modeCount = xcb_randr_get_screen_resources_current_modes_length(resources);
+		for (int i = 0; i < modeCount; ++i) {
+			if (modes[i].id == crtcInfo->mode) {
+				display.refreshRate = refresh_rate(modes[i]);
+				break;
+			}
+		}
+	}
+};
+
+#endif
+
+/**
+ * A refresh in flight. Every handler it registered shares it, the last one
+ * to run builds and publishes the snapshot
+ */
+struct Refresh {
+	std::function<void(bool changed)> done;
+	xcb_screen_t* screen = nullptr;
+	// Handlers that have not run yet
+	unsigned pending = 0;
+#if XWIN_XCB_RANDR
+	RandrState randr;
+	xcb_randr_get_monitors_reply_t* monitors = nullptr;
+	xcb_randr_output_t primary = 0;
+
+	~Refresh() { free(monitors); }
+#endif
+};
+
+auto publish(std::unique_ptr<DisplaySnapshot> snapshot) -> bool {
+	if (sPublished && same_displays(sPublished->displays, snapshot->displays)) {
+		free_retired();
+		return false;
+	}
+	sCurrent.store(snapshot.get(), std::memory_order_seq_cst);
+	if (sPublished) {
+		sRetired.push_back(std::move(sPublished));
+	}
+	sPublished = std::move(snapshot);
+	free_retired();
+	return true;
+}
+
+auto finish(const Refresh& refresh) -> void {
+	std::unique_ptr<DisplaySnapshot> snapshot(new DisplaySnapshot());
+#if XWIN_XCB_RANDR
+	const RandrState& randr = refresh.randr;
+	if (randr.resources) {
+		if (refresh.monitors) {
+			for (xcb_randr_monitor_info_iterator_t monitor = xcb_randr_get_monitors_monitors_iterator(refresh.monitors);
+				 monitor.rem; xcb_randr_monitor_info_next(&monitor)) {
+				const xcb_randr_monitor_info_t* info = monitor.data;
+				DisplayDesc display;
+				display.x = info->x;
+				display.y = info->y;
+				display.width = info->width;
+				display.height = info->height;
+				display.widthMillimeters = info->width_in_millimeters;
+				display.heightMillimeters = info->height_in_millimeters;
+				display.primary = info->primary != 0;
+				if (xcb_randr_monitor_info_outputs_length(info) > 0) {
+					randr.describe(xcb_randr_monitor_info_outputs(info)[0], display);
+				}
+				snapshot->displays.push_back(display);
+			}
+		} else {
+			const xcb_randr_crtc_t* crtcIds = xcb_randr_get_screen_resources_current_crtcs(randr.resources);
+			const xcb_randr_output_t* outputIds = xcb_randr_get_screen_resources_current_outputs(randr.resources);
+			for (size_t i = 0; i < randr.crtcs.size(); ++i) {
+				const xcb_randr_get_crtc_info_reply_t* crtc = randr.crtcs[i];
+				if (!crtc || !crtc->mode || !crtc->width || !crtc->height) {
+					continue;
+				}
+				DisplayDesc display;
+				display.x = crtc->x;
+				display.y = crtc->y;
+				display.width = crtc->width;
+				display.height = crtc->height;
+				for (size_t j = 0; j < randr.outputs.size(); ++j) {
+					const xcb_randr_get_output_info_reply_t* output = randr.outputs[j];
+					if (output && output->crtc == crtcIds[i]) {
+						display.widthMillimeters = output->mm_width;
+						display.heightMillimeters = output->mm_height;
+						display.primary = outputIds[j] == refresh.primary;
+						randr.describe(outputIds[j], display);
+						break;
+					}
+				}
+				snapshot->displays.push_back(display);
+			}
+		}
+	}
+#endif
+
+	// Without RandR the core protocol still knows the screen as a whole
+	if (snapshot->displays.empty()) {
+		DisplayDesc display;
+		display.width = refresh.screen->width_in_pixels;
+		display.height = refresh.screen->height_in_pixels;
+		display.widthMillimeters = refresh.screen->width_in_millimeters;
+		display.heightMillimeters = refresh.screen->height_in_millimeters;
+		display.primary = true;
+		snapshot->displays.push_back(display);
+	}
+
+	for (DisplayDesc& display : snapshot->displays) {
+		display.scale = sDpi.scale_of(display);
+	}
+
+	const bool changed = publish(std::move(snapshot));
+	if (refresh.done) {
+		refresh.done(changed);
+	}
+}
+
+// Registers a handler that counts towards the refresh, reply is null if the request failed
+template <typename Reply, typename Cookie>
+auto expect(const std::shared_ptr<Refresh>& refresh, Requests& requests, Cookie cookie,
+			std::function<void(Reply* reply)> handler) -> void {
+	++refresh->pending;
+	requests.on_reply<Reply>(cookie, [refresh, handler](Reply* reply, xcb_generic_error_t*) {
+		handler(reply);
+		if (--refresh->pending == 0) {
+			finish(*refresh);
+		}
+	});
+}
+
+#if XWIN_XCB_RANDR
+
+// Second burst: every CRTC and output at once
+auto fetch_randr(const std::shared_ptr<Refresh>& refresh, xcb_connection_t* connection, Requests& requests) -> void {
+	const xcb_randr_get_screen_resources_current_reply_t* resources = refresh->randr.resources;
+	const xcb_randr_crtc_t* crtcIds = xcb_randr_get_screen_resources_current_crtcs(resources);
+	const xcb_randr_output_t* outputIds = xcb_randr_get_screen_resources_current_outputs(resources);
+	const size_t crtcCount = static_cast<size_t>(xcb_randr_get_screen_resources_current_crtcs_length(resources));
+	const size_t outputCount = static_cast<size_t>(xcb_randr_get_screen_resources_current_outputs_length(resources));
+	RandrState* randr = &refresh->randr;
+	randr->crtcs.assign(crtcCount, nullptr);
+	randr->outputs.assign(outputCount, nullptr);
+	for (size_t i = 0; i < crtcCount; ++i) {
+		expect<xcb_randr_get_crtc_info_reply_t>(
+			refresh, requests, xcb_randr_get_crtc_info(connection, crtcIds[i], resources->config_timestamp),
+			[randr, i](xcb_randr_get_crtc_info_reply_t* reply) { randr->crtcs[i] = copy_reply(reply); });
+	}
+	for (size_t i = 0; i < outputCount; ++i) {
+		expect<xcb_randr_get_output_info_reply_t>(
+			refresh, requests, xcb_randr_get_output_info(connection, outputIds[i], resources->config_timestamp),
+			[randr, i](xcb_randr_get_output_info_reply_t* reply) { randr->outputs[i] = copy_reply(reply); });
+	}
+}
+
+#endif
+
+} // namespace
+
+auto DisplaySnapshot::find(const Rect& rect) const -> const DisplayDesc* {
+	// Empty windows still sit somewhere
+	const int width = static_cast<int>(std::max(rect.width, 1u));
+	const int height = static_cast<int>(std::max(rect.height, 1u));
+	const DisplayDesc* best = nullptr;
+	long long bestArea = 0;
+	for (const DisplayDesc& display : displays) {
+		const int x0 = std::max(rect.x, display.x);
+		const int y0 = std::max(rect.y, display.y);
+		const int x1 = std::min(rect.x + width, display.x + static_cast<int>(display.width));
+		const int y1 = std::min(rect.y + height, display.y + static_cast<int>(display.height));
+		const long long area = (x1 > x0 && y1 > y0) ? static_cast<long long>(x1 - x0) * (y1 - y0) : 0;
+		if (area > bestArea) {
+			bestArea = area;
+			best = &display;
+		}
+	}
+	return best;
+}
+
+auto select_display_input(xcb_connection_t* connection, xcb_screen_t* screen, const Extensions& extensions) -> void {
+	// Xft.dpi changes arrive as RESOURCE_MANAGER property changes on the root
+	const uint32_t rootMask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+	xcb_change_window_attributes(connection, screen->root, XCB_CW_EVENT_MASK, &rootMask);
+#if XWIN_XCB_RANDR
+	if (extensions.randrFirstEvent) {
+		xcb_randr_select_input(connection, screen->root,
+							   XCB_RANDR_NOTIFY_MASK_SCREEN_CHANGE | XCB_RANDR_NOTIFY_MASK_CRTC_CHANGE |
+								   XCB_RANDR_NOTIFY_MASK_OUTPUT_CHANGE);
+	}
+#else
+	(void)extensions;
+#endif
+}
+
+auto refresh_displays(xcb_connection_t* connection, xcb_screen_t* screen, const Extensions& extensions,
+					  Requests& requests, std::function<void(bool changed)> done) -> void {
+	std::shared_ptr<Refresh> refresh(new Refresh());
+	refresh->done = std::move(done);
+	refresh->screen = screen;
+
+	// First burst: the resource database and the RandR layout
+	expect<xcb_get_property_reply_t>(refresh, requests, DpiCache::request(connection, screen),
+									 [](xcb_get_property_reply_t* reply) { sDpi.update(reply); });
+#if XWIN_XCB_RANDR
+	if (extensions.randrFirstEvent) {
+		Refresh* state = refresh.get();
+		expect<xcb_randr_get_screen_resources_current_reply_t>(
+			refresh, requests, xcb_randr_get_screen_resources_current(connection, screen->root),
+			[refresh, connection, &requests](xcb_randr_get_screen_resources_current_reply_t* reply) {
+				if (reply) {
+					refresh->randr.resources = copy_reply(reply);
+					fetch_randr(refresh, connection, requests);
+				}
+			});
+		// Monitors came with RandR 1.5, before that every active CRTC is a display
+		if (extensions.randrMinor >= 5) {
+			expect<xcb_randr_get_monitors_reply_t>(
+				refresh, requests, xcb_randr_get_monitors(connection, screen->root, 1),
+				[state](xcb_randr_get_monitors_reply_t* reply) { state->monitors = copy_reply(reply); });
+		} else {
+			expect<xcb_randr_get_output_primary_reply_t>(
+				refresh, requests, xcb_randr_get_output_primary(connection, screen->root),
+				[state](xcb_randr_get_output_primary_reply_t* reply) { state->primary = reply ? reply->output : 0; });
+		}
+	}
+#else
+	(void)extensions;
+#endif
+}
+
+auto release_displays() -> void {
+	sCurrent.store(nullptr, std::memory_order_seq_cst);
+	sRetired.clear();
+	sPublished.reset();
+}
+
+CurrentDisplays::CurrentDisplays() {
+	// Counted before the load, see free_retired
+	sReaders.fetch_add(1, std::memory_order_seq_cst);
+	const DisplaySnapshot* snapshot = sCurrent.load(std::memory_order_seq_cst);
+	mSnapshot = snapshot ? snapshot : &sEmpty;
+}
+
+CurrentDisplays::~CurrentDisplays() {
+	sReaders.fetch_sub(1, std::memory_order_release);
+}
+
+std::vector<DisplayDesc> enumerateDisplays() { return CurrentDisplays()->displays; }
+
+} // namespace xwin
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../Common/DisplayDesc.h"
+#include "../Common/WindowDesc.h"
+#include "XCBExtensions.h"
+#include "XCBRequests.h"
+
+#include <functional>
+#include <vector>
+#include <xcb/xcb.h>
+
+namespace xwin {
+
+/**
+ * Immutable view of the displays at one point in time. A new snapshot is
+ * published whenever RandR or Xft.dpi report a change, readers on any thread
+ * go through CurrentDisplays and never lock.
+ */
+struct DisplaySnapshot {
+	std::vector<DisplayDesc> displays;
+	// Display covering most of rect, given in root coordinates, null if none does
+	[[nodiscard]] auto find(const Rect& rect) const -> const DisplayDesc*;
+};
+
+// Asks for the RandR and root property notifications that make the snapshot stale
+auto select_display_input(xcb_connection_t* connection, xcb_screen_t* screen, const Extensions& extensions) -> void;
+// Queries the server through requests. Once the last reply is in a new
+// snapshot is published and done learns whether it differs from the previous one
+auto refresh_displays(xcb_connection_t* connection, xcb_screen_t* screen, const Extensions& extensions,
+					  Requests& requests, std::function<void(bool changed)> done) -> void;
+// Frees every snapshot, only once no other thread can be reading them
+auto release_displays() -> void;
+
+/**
+ * Holds the latest snapshot, empty before the first refresh, for as long as
+ * this lives. Replaced snapshots are freed once no reader holds them, so keep
+ * one only while reading.
+ */
+class CurrentDisplays {
+public:
+	CurrentDisplays();
+	~CurrentDisplays();
+	CurrentDisplays(const CurrentDisplays&) = delete;
+	CurrentDisplays& operator=(const CurrentDisplays&) = delete;
+	auto operator->() const -> const DisplaySnapshot* { return mSnapshot; }
+	auto operator*() const -> const DisplaySnapshot& { return *mSnapshot; }
+protected:
+	const DisplaySnapshot* mSnapshot;
+};
+
+} // namespace xwin
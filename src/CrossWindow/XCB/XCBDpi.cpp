@@ -0,0 +1,35 @@
+#include "XCBDpi.h"
+#include "../Common/DisplayScale.h"
+
+namespace xwin {
+
+namespace {
+
+// RESOURCE_MANAGER is read whole, it rarely exceeds a few kilobytes
+constexpr uint32_t kResourceManagerMaxLongs = 0x10000;
+
+} // namespace
+
+auto DpiCache::request(xcb_connection_t* connection, xcb_screen_t* screen) -> xcb_get_property_cookie_t {
+	return xcb_get_property(connection, 0, screen->root, XCB_ATOM_RESOURCE_MANAGER, XCB_GET_PROPERTY_TYPE_ANY, 0,
+							kResourceManagerMaxLongs);
+}
+
+auto DpiCache::update(const xcb_get_property_reply_t* resourceManager) -> void {
+	mXftScale = 0.0f;
+	if (!resourceManager) {
+		return;
+	}
+	const float dpi = parseXftDpi(static_cast<const char*>(xcb_get_property_value(resourceManager)),
+								  static_cast<size_t>(xcb_get_property_value_length(resourceManager)));
+	if (dpi > 0.0f) {
+		mXftScale = dpi / 96.0f;
+	}
+}
+
+auto DpiCache::scale_of(const DisplayDesc& display) const -> float {
+	// Xft.dpi is the user's explicit choice and applies to every display
+	return mXftScale > 0.0f ? mXftScale : physicalScale(display);
+}
+
+} // namespace xwin
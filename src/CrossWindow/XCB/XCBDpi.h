@@ -0,0 +1,27 @@
+#pragma once
+
+#include "../Common/DisplayDesc.h"
+
+#include <xcb/xcb.h>
+
+namespace xwin {
+
+/**
+ * Display scale (DPI / 96). Xft.dpi from the root window's RESOURCE_MANAGER
+ * wins when the user set it, otherwise each display's physical size decides.
+ * Updated along with the display snapshot, so lookups never reach the server.
+ */
+class DpiCache {
+public:
+	// Asks for RESOURCE_MANAGER, whose reply goes to update()
+	static auto request(xcb_connection_t* connection, xcb_screen_t* screen) -> xcb_get_property_cookie_t;
+	// Takes Xft.dpi from RESOURCE_MANAGER, null if it could not be read
+	auto update(const xcb_get_property_reply_t* resourceManager) -> void;
+	// Scale windows on this display should render at
+	[[nodiscard]] auto scale_of(const DisplayDesc& display) const -> float;
+protected:
+	// Xft.dpi / 96, 0 when unset
+	float mXftScale = 0.0f;
+};
+
+} // namespace xwin
@@ -0,0 +1,315 @@
+#include "XCBDragDrop.h"
+#include "../Common/Counters.h"
+#include "../Common/Init.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace xwin {
+
+namespace {
+
+// Highest XDND version we speak, advertised in XdndAware
+constexpr uint32_t kXdndVersion = 5;
+
+// Most entries of an XdndTypeList we look through
+constexpr uint32_t kMaxTypes = 1024;
+
+auto hex_value(char c) -> int {
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+	if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+} // namespace
+
+auto DragDrop::init(xcb_connection_t* connection, Clipboard* clipboard, Requests* requests) -> void {
+	mConnection = connection;
+	mClipboard = clipboard;
+	mRequests = requests;
+}
+
+auto DragDrop::release() -> void {
+	end_drag();
+	mDropSource = 0;
+	mDropWindow = nullptr;
+	mConnection = nullptr;
+}
+
+auto DragDrop::on_client_message(const xcb_client_message_event_t* event, Window* window, int originX, int originY) -> bool {
+	const AtomCache& atoms = getXWinState().atoms;
+	if (event->format != 32) {
+		return false;
+	}
+	const uint32_t* data = event->data.data32;
+
+	if (event->type == atoms[AtomId::XDND_ENTER]) {
+		end_drag();
+		mReportedX = -1;
+		mReportedY = -1;
+		mSource = data[0];
+		mTarget = event->window;
+		mWindow = window;
+		mVersion = std::min(data[1] >> 24, kXdndVersion);
+		if (data[1] & 1) {
+			// More than three types, the full list is on the source window
+			const xcb_get_property_cookie_t cookie =
+				xcb_get_property(mConnection, 0, mSource, atoms[AtomId::XDND_TYPE_LIST], XCB_ATOM_ATOM, 0, kMaxTypes);
+			const xcb_window_t source = mSource;
+			mRequests->on_reply<xcb_get_property_reply_t>(
+				cookie, [this, source](xcb_get_property_reply_t* reply, xcb_generic_error_t*) { on_type_list(source, reply); });
+			mTypesPending = true;
+			xcb_flush(mConnection);
+			count(Counter::Flushes);
+		} else {
+			const xcb_atom_t uriList = atoms[AtomId::TEXT_URI_LIST];
+			mAccepted = data[2] == uriList || data[3] == uriList || data[4] == uriList;
+		}
+		return true;
+	}
+	if (event->type == atoms[AtomId::XDND_POSITION]) {
+		if (data[0] != mSource) {
+			return true;
+		}
+		// Root coordinates packed as x << 16 | y
+		mX = static_cast<int16_t>(data[2] >> 16) - originX;
+		mY = static_cast<int16_t>(data[2] & 0xffff) - originY;
+		mHoverWindow = window;
+		mHoverPending = true;
+		mHoverLeft = false;
+		// Every position is answered before the source sends the next one
+		if (mTypesPending) {
+			mStatusOwed = true;
+		} else {
+			send_status();
+		}
+		return true;
+	}
+	if (event->type == atoms[AtomId::XDND_LEAVE]) {
+		if (data[0] == mSource) {
+			mHoverPending = mHoverWindow != nullptr;
+			mHoverLeft = true;
+			end_drag();
+		}
+		return true;
+	}
+	if (event->type == atoms[AtomId::XDND_DROP]) {
+		if (data[0] != mSource) {
+			return true;
+		}
+		if (!mAccepted || mTypesPending || mDropSource != 0 || mDropReady) {
+			// Only one drop streams at a time, later ones are refused until it is done
+			// and, since its paths live in mText, until update() has reported it
+			send_finished(mSource, mTarget, mVersion, false);
+			end_drag();
+			return true;
+		}
+		mDropSource = mSource;
+		mDropTarget = mTarget;
+		mDropVersion = mVersion;
+		mDropWindow = window;
+		mDropX = mX;
+		mDropY = mY;
+		// The DropFile event ends the hover
+		mHoverPending = false;
+		mHoverWindow = nullptr;
+		end_drag();
+
+		// Paths handed out with the last drop were valid until this update
+		mText.clear();
+		mOffsets.clear();
+		mPaths.clear();
+		mWrite = 0;
+		mRead = 0;
+		const xcb_timestamp_t time = mDropVersion >= 1 ? data[2] : XCB_CURRENT_TIME;
+		mClipboard->convert(atoms[AtomId::XDND_SELECTION], atoms[AtomId::TEXT_URI_LIST], time,
+							[this](Clipboard::Status status, const uint8_t* bytes, size_t size) {
+								on_uri_data(status, bytes, size);
+							});
+		return true;
+	}
+	return false;
+}
+
+auto DragDrop::on_type_list(xcb_window_t source, xcb_get_property_reply_t* reply) -> void {
+	// The drag may have left, or another begun, while the list was on its way
+	if (source != mSource || !mTypesPending) {
+		return;
+	}
+	mTypesPending = false;
+	if (reply != nullptr) {
+		const xcb_atom_t* types = static_cast<const xcb_atom_t*>(xcb_get_property_value(reply));
+		const size_t count = static_cast<size_t>(xcb_get_property_value_length(reply)) / sizeof(xcb_atom_t);
+		mAccepted = std::find(types, types + count, getXWinState().atoms[AtomId::TEXT_URI_LIST]) != types + count;
+	}
+	if (mStatusOwed) {
+		mStatusOwed = false;
+		send_status();
+	}
+}
+
+auto DragDrop::take_hover(Window** window, HoverFileData* hover) -> bool {
+	if (!mHoverPending) {
+		return false;
+	}
+	mHoverPending = false;
+	if (!mHoverLeft && mX == mReportedX && mY == mReportedY) {
+		return false;
+	}
+	*window = mHoverWindow;
+	*hover = HoverFileData(mX, mY, mHoverLeft);
+	if (mHoverLeft) {
+		mHoverWindow = nullptr;
+		mReportedX = -1;
+		mReportedY = -1;
+	} else {
+		mReportedX = mX;
+		mReportedY = mY;
+	}
+	return true;
+}
+
+auto DragDrop::take_drop(Window** window, DropFileData* drop) -> bool {
+	if (!mDropReady) {
+		return false;
+	}
+	mDropReady = false;
+	*window = mDropWindow;
+	*drop = DropFileData(mDropX, mDropY, mPaths.data(), mPaths.size());
+	mDropWindow = nullptr;
+	return *window != nullptr;
+}
+
+auto DragDrop::remove_window(Window* window) -> void {
+	if (mWindow == window) {
+		end_drag();
+	}
+	if (mHoverWindow == window) {
+		mHoverWindow = nullptr;
+		mHoverPending = false;
+	}
+	if (mDropWindow == window) {
+		// The transfer runs to completion so the source is told, nothing is reported
+		mDropWindow = nullptr;
+	}
+}
+
+auto DragDrop::send_status() -> void {
+	const AtomCache& atoms = getXWinState().atoms;
+	xcb_client_message_event_t status = {};
+	status.response_type = XCB_CLIENT_MESSAGE;
+	status.format = 32;
+	status.window = mSource;
+	status.type = atoms[AtomId::XDND_STATUS];
+	status.data.data32[0] = mTarget;
+	// An empty no-motion rectangle, every move sends a position
+	status.data.data32[1] = mAccepted ? 1 : 0;
+	status.data.data32[4] = mAccepted ? atoms[AtomId::XDND_ACTION_COPY] : static_cast<xcb_atom_t>(XCB_ATOM_NONE);
+	xcb_send_event(mConnection, 0, mSource, XCB_EVENT_MASK_NO_EVENT, reinterpret_cast<const char*>(&status));
+	xcb_flush(mConnection);
+	count(Counter::Flushes);
+}
+
+auto DragDrop::send_finished(xcb_window_t source, xcb_window_t target, uint32_t version, bool accepted) -> void {
+	const AtomCache& atoms = getXWinState().atoms;
+	xcb_client_message_event_t finished = {};
+	finished.response_type = XCB_CLIENT_MESSAGE;
+	finished.format = 32;
+	finished.window = source;
+	finished.type = atoms[AtomId::XDND_FINISHED];
+	finished.data.data32[0] = target;
+	if (version >= 5) {
+		finished.data.data32[1] = accepted ? 1 : 0;
+		finished.data.data32[2] = accepted ? atoms[AtomId::XDND_ACTION_COPY] : static_cast<xcb_atom_t>(XCB_ATOM_NONE);
+	}
+	xcb_send_event(mConnection, 0, source, XCB_EVENT_MASK_NO_EVENT, reinterpret_cast<const char*>(&finished));
+	xcb_flush(mConnection);
+	count(Counter::Flushes);
+}
+
+auto DragDrop::on_uri_data(Clipboard::Status status, const uint8_t* data, size_t size) -> void {
+	if (status == Clipboard::Status::Data) {
+		mText.insert(mText.end(), data, data + size);
+		parse_lines(false);
+		return;
+	}
+	const bool done = status == Clipboard::Status::Done;
+	if (done) {
+		parse_lines(true);
+		// mText no longer grows, so pointers into it stay put
+		for (size_t offset : mOffsets) {
+			mPaths.push_back(mText.data() + offset);
+		}
+		mDropReady = !mPaths.empty();
+	}
+	send_finished(mDropSource, mDropTarget, mDropVersion, done);
+	mDropSource = 0;
+}
+
+auto DragDrop::parse_lines(bool final) -> void {
+	const size_t size = mText.size();
+	while (mRead < size) {
+		const char* newline = static_cast<const char*>(memchr(mText.data() + mRead, '\n', size - mRead));
+		if (newline == nullptr && !final) {
+			break;
+		}
+		size_t end = newline ? static_cast<size_t>(newline - mText.data()) : size;
+		const size_t next = newline ? end + 1 : size;
+		if (end > mRead && mText[end - 1] == '\r') {
+			--end;
+		}
+		decode_line(mRead, end);
+		mRead = next;
+	}
+	// Only the partial last line is moved, to follow the decoded paths
+	mText.erase(mText.begin() + static_cast<ptrdiff_t>(mWrite), mText.begin() + static_cast<ptrdiff_t>(mRead));
+	mRead = mWrite;
+}
+
+auto DragDrop::decode_line(size_t begin, size_t end) -> void {
+	// Comments and other schemes are skipped
+	static const char scheme[] = "file://";
+	const size_t schemeLength = sizeof(scheme) - 1;
+	if (end - begin < schemeLength || memcmp(mText.data() + begin, scheme, schemeLength) != 0) {
+		return;
+	}
+	// Skip the host, the path is on this machine
+	size_t in = begin + schemeLength;
+	while (in < end && mText[in] != '/') {
+		++in;
+	}
+	if (in == end) {
+		return;
+	}
+
+	// Decoding never grows the text, so it is written over what was consumed
+	const size_t start = mWrite;
+	while (in < end) {
+		char c = mText[in++];
+		if (c == '%' && in + 1 < end && hex_value(mText[in]) >= 0 && hex_value(mText[in + 1]) >= 0) {
+			c = static_cast<char>(hex_value(mText[in]) << 4 | hex_value(mText[in + 1]));
+			in += 2;
+		}
+		mText[mWrite++] = c;
+	}
+	mText[mWrite++] = '\0';
+	mOffsets.push_back(start);
+}
+
+auto DragDrop::end_drag() -> void {
+	mTypesPending = false;
+	mSource = 0;
+	mTarget = 0;
+	mWindow = nullptr;
+	mAccepted = false;
+	mStatusOwed = false;
+}
+
+} // namespace xwin
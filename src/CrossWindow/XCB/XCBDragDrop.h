@@ -0,0 +1,87 @@
+#pragma once
+
+#include "../Common/Event.h"
+#include "XCBClipboard.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <xcb/xcb.h>
+
+namespace xwin {
+
+struct Window;
+
+/**
+ * XDND version 5 drop target for the windows of an EventQueue. Dropped
+ * text/uri-list data streams in through the Clipboard and is decoded in place
+ * into one reused buffer, so dropping thousands of files allocates nothing per
+ * path and never waits on the source.
+ */
+class DragDrop {
+protected:
+	auto init(xcb_connection_t* connection, Clipboard* clipboard, Requests* requests) -> void;
+	auto release() -> void;
+	// Handles an Xdnd client message sent to window, whose top left corner is
+	// at originX, originY in root coordinates. Returns false for other messages
+	auto on_client_message(const xcb_client_message_event_t* event, Window* window, int originX, int originY) -> bool;
+	// Hover change since the last call, moves to the same spot are dropped
+	auto take_hover(Window** window, HoverFileData* hover) -> bool;
+	// A drop whose paths have all been decoded
+	auto take_drop(Window** window, DropFileData* drop) -> bool;
+	// Forgets a window being destroyed
+	auto remove_window(Window* window) -> void;
+
+	auto on_type_list(xcb_window_t source, xcb_get_property_reply_t* reply) -> void;
+	auto send_status() -> void;
+	auto send_finished(xcb_window_t source, xcb_window_t target, uint32_t version, bool accepted) -> void;
+	auto on_uri_data(Clipboard::Status status, const uint8_t* data, size_t size) -> void;
+	// Decodes each complete line of mText, and the unterminated last one when final
+	auto parse_lines(bool final) -> void;
+	auto decode_line(size_t begin, size_t end) -> void;
+	auto end_drag() -> void;
+
+	xcb_connection_t* mConnection = nullptr;
+	Clipboard* mClipboard = nullptr;
+	Requests* mRequests = nullptr;
+
+	// The drag over one of our windows, if any
+	xcb_window_t mSource = 0;
+	xcb_window_t mTarget = 0;
+	Window* mWindow = nullptr;
+	uint32_t mVersion = 0;
+	bool mAccepted = false;
+	// Sources with more than three types list them in a property
+	bool mTypesPending = false;
+	// A position arrived before the type list, its status goes out with the reply
+	bool mStatusOwed = false;
+
+	// Latest position, reported once per update
+	int mX = 0;
+	int mY = 0;
+	bool mHoverPending = false;
+	bool mHoverLeft = false;
+	Window* mHoverWindow = nullptr;
+	int mReportedX = -1;
+	int mReportedY = -1;
+
+	// The drop being transferred, decoupled from the drag so a new one can start
+	xcb_window_t mDropSource = 0;
+	xcb_window_t mDropTarget = 0;
+	Window* mDropWindow = nullptr;
+	uint32_t mDropVersion = 0;
+	int mDropX = 0;
+	int mDropY = 0;
+	bool mDropReady = false;
+
+	// Decoded, null terminated paths followed by the undecoded tail of the
+	// uri list, all in one buffer reused from drop to drop
+	std::vector<char> mText;
+	size_t mWrite = 0;
+	size_t mRead = 0;
+	std::vector<size_t> mOffsets;
+	std::vector<const char*> mPaths;
+	friend class EventQueue;
+};
+
+} // namespace xwin
@@ -1,29 +1,903 @@
 #include "XCBEventQueue.h"
+#include "../Common/Counters.h"
 #include "../Common/Init.h"
+#include "../Common/RoundTrips.h"
+#include "../Common/Trace.h"
+#include "../Common/Window.h"
+#include "XCBDisplays.h"
+
+#include <algorithm>
+#include <poll.h>
+#include <stdlib.h>
+
+#if XWIN_XCB_XINPUT
+#include <xcb/xinput.h>
+#endif
+#if XWIN_XCB_PRESENT
+#include <xcb/present.h>
+#endif
+#if XWIN_XCB_SHM
+#include <xcb/shm.h>
+#endif
+#if XWIN_XCB_SYNC
+#include <xcb/sync.h>
+#endif
+#if XWIN_XCB_RANDR
+#include <xcb/randr.h>
+#endif
 
 namespace xwin
 {
-EventQueue::EventQueue() {}
+#if XWIN_XCB_XINPUT
+namespace
+{
+double toDouble(xcb_input_fp3232_t value)
+{
+    return value.integral + value.frac / 4294967296.0;
+}
+
+void selectXInput(xcb_connection_t* connection, xcb_window_t window,
+                  uint16_t deviceid, uint32_t events)
+{
+    struct
+    {
+        xcb_input_event_mask_t head;
+        uint32_t mask;
+    } eventMask;
+    eventMask.head.deviceid = deviceid;
+    eventMask.head.mask_len = 1;
+    eventMask.mask = events;
+    xcb_input_xi_select_events(connection, window, 1, &eventMask.head);
+}
+}
+#endif
+
+EventQueue::EventQueue()
+{
+    const XWinState& xwinState = getXWinState();
+    select_display_input(xwinState.connection, xwinState.screen,
+                         xwinState.extensions);
+    mRequests.init(xwinState.connection);
+    mClipboard.init(xwinState.connection, xwinState.screen, &mRequests);
+    mDragDrop.init(xwinState.connection, &mClipboard, &mRequests);
+#if XWIN_XCB_XINPUT
+    if (xwinState.extensions.has_xinput(1))
+    {
+        // Devices rarely change, ask once and follow the change events
+        queryScrollAxes(XCB_INPUT_DEVICE_ALL);
+    }
+#endif
+}
+
+EventQueue::~EventQueue()
+{
+    // Pending handlers point into the clipboard and drag and drop state
+    mRequests.release();
+    mDragDrop.release();
+    mClipboard.release();
+}
 
 void EventQueue::update()
 {
+    // Whatever the application did since the last update is one frame
+    finishRoundTripFrame();
+    UpdateTimer timer;
+    XWIN_TRACE_SCOPE("update");
     const XWinState& xwinState = getXWinState();
     xcb_connection_t* connection = xwinState.connection;
+    for (TouchPoint& touch : mTouches)
+    {
+        touch.isChanged = false;
+    }
+
+#if XWIN_XCB_SYNC
+    // The application has handled everything from the last update, so the
+    // frames for those sizes are drawn
+    for (Window* window : mSyncAcks)
+    {
+        xcb_sync_int64_t value;
+        value.hi = static_cast<int32_t>(window->mSyncValue >> 32);
+        value.lo = static_cast<uint32_t>(window->mSyncValue);
+        xcb_sync_set_counter(connection, window->mSyncCounter, value);
+    }
+#endif
+    mSyncAcks.clear();
+    mRequests.fence();
     xcb_flush(connection);
-    xcb_wait_for_event(connection);
-    xcb_generic_event_t* e;
-    while (xcb_generic_event_t* e = xcb_poll_for_event(connection))
+    count(Counter::Flushes);
+
+    // Pending paints without vblank timing are due now, don't block on input
+    xcb_generic_event_t* e = nullptr;
+    if (!mPaintRequests.empty())
     {
-        pushEvent(e);
+        XWIN_TRACE_SCOPE("read");
+        e = xcb_poll_for_event(connection);
     }
+    else if (mRequests.waiting())
+    {
+        XWIN_TRACE_SCOPE("wait");
+        e = waitForEventOrReply(connection);
+    }
+    else
+    {
+        XWIN_TRACE_SCOPE("wait");
+        count(Counter::SocketReads);
+        e = xcb_wait_for_event(connection);
+    }
+    while (e)
+    {
+        count(Counter::EventsRead);
+        {
+            XWIN_TRACE_SCOPE("decode");
+            pushEvent(e);
+        }
+        free(e);
+        XWIN_TRACE_SCOPE("read");
+        e = xcb_poll_for_event(connection);
+    }
+    flushBatched();
+
+    // Replies read in along with the events
+    mRequests.poll();
+    Window* dropWindow = nullptr;
+    DropFileData drop(0, 0, nullptr, 0);
+    if (mDragDrop.take_drop(&dropWindow, &drop))
+    {
+        enqueue(Event(drop, dropWindow));
+    }
+
+    // Output and resource changes arrive in bursts, ask the server once. The
+    // snapshot is published when the replies are read in a later update
+    if (mDisplaysDirty)
+    {
+        mDisplaysDirty = false;
+        refresh_displays(connection, xwinState.screen, xwinState.extensions,
+                         mRequests,
+                         [this](bool changed)
+                         {
+                             if (changed)
+                             {
+                                 enqueue(Event(EventType::DisplayChange,
+                                                nullptr));
+                             }
+                             mWindows.forEach(
+                                 [this](WindowHandle, Window* window)
+                                 { updateDpi(window); });
+                         });
+    }
+
+    for (Window* window : mPaintRequests)
+    {
+        mWindows.flags(window->mHandle) &= ~WindowPool::PaintRequested;
+        enqueue(Event(PaintData(), window));
+    }
+    mPaintRequests.clear();
 }
 
 const Event& EventQueue::front() { return mQueue.front(); }
 
-void EventQueue::pop() { mQueue.pop(); }
+void EventQueue::pop()
+{
+    XWIN_TRACE_SCOPE("deliver");
+    XWIN_TRACE_FLOW_END(mQueue.frontFlow());
+    mQueue.pop();
+}
 
 bool EventQueue::empty() { return mQueue.empty(); }
 
+void EventQueue::setCapacity(size_t capacity, OverflowPolicy policy)
+{
+    mQueue.setCapacity(capacity, policy);
+}
+
+const EventBufferStats& EventQueue::getOverflowStats() const
+{
+    return mQueue.stats();
+}
+
+const std::vector<TouchPoint>& EventQueue::getTouches() const
+{
+    return mTouches;
+}
+
+Clipboard& EventQueue::getClipboard() { return mClipboard; }
+
+Requests& EventQueue::getRequests() { return mRequests; }
+
+xcb_generic_event_t* EventQueue::waitForEventOrReply(
+    xcb_connection_t* connection)
+{
+    while (!xcb_connection_has_error(connection))
+    {
+        if (mRequests.poll())
+        {
+            return xcb_poll_for_event(connection);
+        }
+        xcb_generic_event_t* e = xcb_poll_for_event(connection);
+        if (e)
+        {
+            return e;
+        }
+        // Polling for the event read the socket, the reply may be in now
+        if (mRequests.poll())
+        {
+            return nullptr;
+        }
+        pollfd fd = {xcb_get_file_descriptor(connection), POLLIN, 0};
+        count(Counter::SocketReads);
+        ::poll(&fd, 1, -1);
+    }
+    return nullptr;
+}
+
+WindowHandle EventQueue::addWindow(xcb_window_t id, Window* window)
+{
+    const WindowHandle handle = mWindows.insert(window, id);
+
+#if XWIN_XCB_XINPUT
+    const XWinState& xwinState = getXWinState();
+    if (!mRawSelected && xwinState.extensions.has_xinput())
+    {
+        // Raw events are only delivered to the root window
+        selectXInput(xwinState.connection, xwinState.screen->root,
+                     XCB_INPUT_DEVICE_ALL_MASTER,
+                     XCB_INPUT_XI_EVENT_MASK_RAW_MOTION);
+        selectXInput(xwinState.connection, xwinState.screen->root,
+                     XCB_INPUT_DEVICE_ALL,
+                     XCB_INPUT_XI_EVENT_MASK_DEVICE_CHANGED |
+                         XCB_INPUT_XI_EVENT_MASK_HIERARCHY);
+        mRawSelected = true;
+    }
+    if (xwinState.extensions.has_xinput(1))
+    {
+        // XInput pointer motion and buttons replace the core events for
+        // this window. Motion carries the scroll valuators, buttons whether
+        // the server emulated them from those. Touch events need XInput 2.2.
+        uint32_t events = XCB_INPUT_XI_EVENT_MASK_MOTION |
+                          XCB_INPUT_XI_EVENT_MASK_BUTTON_PRESS |
+                          XCB_INPUT_XI_EVENT_MASK_BUTTON_RELEASE;
+        if (xwinState.extensions.has_xinput(2))
+        {
+            events |= XCB_INPUT_XI_EVENT_MASK_TOUCH_BEGIN |
+                      XCB_INPUT_XI_EVENT_MASK_TOUCH_UPDATE |
+                      XCB_INPUT_XI_EVENT_MASK_TOUCH_END;
+        }
+        selectXInput(xwinState.connection, id, XCB_INPUT_DEVICE_ALL_MASTER,
+                     events);
+    }
+#endif
+    return handle;
+}
+
+void EventQueue::removeWindow(xcb_window_t id)
+{
+    const WindowHandle handle = mWindows.find(id);
+    Window* window = mWindows.get(handle);
+    if (!window)
+    {
+        return;
+    }
+    if (mPointerWindow == window)
+    {
+        mRawPending = false;
+        mPointerWindow = nullptr;
+    }
+    if (mWheelWindow == window)
+    {
+        mWheelPending = false;
+        mWheelWindow = nullptr;
+    }
+    if (mMotionWindow == window)
+    {
+        mMotionWindow = nullptr;
+    }
+    mQueue.invalidate(window);
+    mDragDrop.remove_window(window);
+    mPaintRequests.erase(std::remove(mPaintRequests.begin(),
+                                     mPaintRequests.end(), window),
+                         mPaintRequests.end());
+    mSyncAcks.erase(
+        std::remove(mSyncAcks.begin(), mSyncAcks.end(), window),
+        mSyncAcks.end());
+    for (size_t i = mTouches.size(); i-- > 0;)
+    {
+        if (mTouchWindows[i] == window)
+        {
+            mTouches.erase(mTouches.begin() + i);
+            mTouchWindows.erase(mTouchWindows.begin() + i);
+        }
+    }
+    for (size_t i = mTouchMoves.size(); i-- > 0;)
+    {
+        if (mTouchMoves[i].first == window)
+        {
+            mTouchMoves.erase(mTouchMoves.begin() + i);
+        }
+    }
+    mWindows.remove(handle);
+}
+
+void EventQueue::updateDpi(Window* window)
+{
+    CurrentDisplays displays;
+    const DisplayDesc* display =
+        displays->find(mWindows.rect(window->mHandle));
+    const float scale = display ? display->scale : 1.0f;
+    if (scale != window->mDpiScale)
+    {
+        window->mDpiScale = scale;
+        enqueue(Event(DpiData(scale), window));
+    }
+}
+
+Window* EventQueue::findWindow(xcb_window_t id) const
+{
+    return mWindows.get(mWindows.find(id));
+}
+
+Window* EventQueue::getWindow(WindowHandle handle) const
+{
+    return mWindows.get(handle);
+}
+
+void EventQueue::enqueue(Event event)
+{
+    // The window is live while its events are routed, later only the handle
+    // can tell
+    if (event.window)
+    {
+        event.handle = event.window->mHandle;
+    }
+    mQueue.push(event);
+}
+
+void EventQueue::pushButton(Window* window, uint32_t button,
+                            ButtonState state, ModifierState modifiers)
+{
+    MouseInput input;
+    switch (button)
+    {
+    case 1:
+        input = MouseInput::Left;
+        break;
+    case 2:
+        input = MouseInput::Middle;
+        break;
+    case 3:
+        input = MouseInput::Right;
+        break;
+    case 4:
+    case 5:
+    case 6:
+    case 7:
+        // Wheel notches, up, down, left, right
+        if (state == ButtonState::Pressed)
+        {
+            double delta = button == 4 ? 1.0 : button == 5 ? -1.0 : 0.0;
+            double deltax = button == 6 ? -1.0 : button == 7 ? 1.0 : 0.0;
+            pushWheel(window, modifiers, delta, deltax);
+        }
+        return;
+    case 8:
+        input = MouseInput::Button4;
+        break;
+    case 9:
+        input = MouseInput::Button5;
+        break;
+    default:
+        return;
+    }
+
+    // Clicks must follow any motion already batched
+    flushBatched();
+    enqueue(Event(MouseInputData(input, state, modifiers), window));
+}
+
+void EventQueue::pushWheel(Window* window, ModifierState modifiers,
+                           double delta, double deltax)
+{
+    if (mWheelPending && mWheelWindow != window)
+    {
+        flushWheel();
+    }
+    else if (mWheelPending)
+    {
+        countEvent(EventCount::Coalesced, EventType::MouseWheel);
+    }
+    mWheelWindow = window;
+    mWheelModifiers = modifiers;
+    mWheelDelta += delta;
+    mWheelDeltaX += deltax;
+    mWheelPending = true;
+}
+
+void EventQueue::pushTouch(Window* window, const TouchPoint& touch,
+                           TouchState state)
+{
+    size_t index = 0;
+    while (index < mTouches.size() && mTouches[index].id != touch.id)
+    {
+        ++index;
+    }
+
+    if (state == TouchState::Moved)
+    {
+        if (index == mTouches.size())
+        {
+            return;
+        }
+        mTouches[index] = touch;
+        for (auto& move : mTouchMoves)
+        {
+            if (move.second.id == touch.id)
+            {
+                countEvent(EventCount::Coalesced, EventType::Touch);
+                move.second = touch;
+                return;
+            }
+        }
+        mTouchMoves.emplace_back(window, touch);
+        return;
+    }
+
+    // Begin and end must follow any moves already batched
+    flushBatched();
+    if (state == TouchState::Began)
+    {
+        if (index == mTouches.size())
+        {
+            mTouches.push_back(touch);
+            mTouchWindows.push_back(window);
+        }
+    }
+    else if (index < mTouches.size())
+    {
+        mTouches.erase(mTouches.begin() + index);
+        mTouchWindows.erase(mTouchWindows.begin() + index);
+    }
+    enqueue(Event(TouchData(touch, state), window));
+}
+
+void EventQueue::flushBatched()
+{
+    XWIN_TRACE_SCOPE("coalesce");
+    flushRawMotion();
+    flushWheel();
+    flushTouches();
+    flushHover();
+}
+
+void EventQueue::flushHover()
+{
+    Window* window = nullptr;
+    HoverFileData hover(0, 0);
+    if (mDragDrop.take_hover(&window, &hover))
+    {
+        enqueue(Event(hover, window));
+    }
+}
+
+void EventQueue::flushRawMotion()
+{
+    if (mRawPending)
+    {
+        enqueue(Event(MouseRawData(mRawDeltaX, mRawDeltaY), mPointerWindow));
+        mRawDeltaX = 0.0;
+        mRawDeltaY = 0.0;
+        mRawPending = false;
+    }
+}
+
+void EventQueue::flushWheel()
+{
+    if (mWheelPending)
+    {
+        enqueue(Event(
+            MouseWheelData(mWheelDelta, mWheelModifiers, mWheelDeltaX),
+            mWheelWindow));
+        mWheelDelta = 0.0;
+        mWheelDeltaX = 0.0;
+        mWheelPending = false;
+    }
+}
+
+void EventQueue::flushTouches()
+{
+    for (const auto& move : mTouchMoves)
+    {
+        enqueue(Event(TouchData(move.second, TouchState::Moved), move.first));
+    }
+    mTouchMoves.clear();
+}
+
+void EventQueue::queryScrollAxes(uint16_t deviceid)
+{
+#if XWIN_XCB_XINPUT
+    xcb_connection_t* connection = getXWinState().connection;
+    mRequests.on_reply<xcb_input_xi_query_device_reply_t>(
+        xcb_input_xi_query_device(connection, deviceid),
+        [this, deviceid](xcb_input_xi_query_device_reply_t* reply,
+                         xcb_generic_error_t*)
+        {
+            if (deviceid == XCB_INPUT_DEVICE_ALL)
+            {
+                mScrollDevices.clear();
+            }
+            else
+            {
+                // Without a reply the device has gone
+                mScrollDevices.erase(deviceid);
+            }
+            if (!reply)
+            {
+                return;
+            }
+
+            for (xcb_input_xi_device_info_iterator_t info =
+                     xcb_input_xi_query_device_infos_iterator(reply);
+                 info.rem; xcb_input_xi_device_info_next(&info))
+            {
+                // The valuators may have moved since the reply was sent, the
+                // next motion event sets where each axis starts
+                std::vector<ScrollAxis> axes;
+                for (xcb_input_device_class_iterator_t cls =
+                         xcb_input_xi_device_info_classes_iterator(info.data);
+                     cls.rem; xcb_input_device_class_next(&cls))
+                {
+                    if (cls.data->type != XCB_INPUT_DEVICE_CLASS_TYPE_SCROLL)
+                    {
+                        continue;
+                    }
+                    const xcb_input_scroll_class_t* scroll =
+                        (const xcb_input_scroll_class_t*)cls.data;
+                    double increment = toDouble(scroll->increment);
+                    if (increment != 0.0)
+                    {
+                        axes.push_back({scroll->number,
+                                        scroll->scroll_type ==
+                                            XCB_INPUT_SCROLL_TYPE_HORIZONTAL,
+                                        increment, 0.0, false});
+                    }
+                }
+                mScrollDevices[info.data->deviceid] = std::move(axes);
+            }
+        });
+#else
+    (void)deviceid;
+#endif
+}
+
+std::vector<EventQueue::ScrollAxis>*
+EventQueue::findScrollAxes(uint16_t deviceid)
+{
+    auto itr = mScrollDevices.find(deviceid);
+    return itr != mScrollDevices.end() ? &itr->second : nullptr;
+}
+
+void EventQueue::pushGenericEvent(const xcb_ge_generic_event_t* ge)
+{
+    const Extensions& extensions = getXWinState().extensions;
+    if (extensions.xinputOpcode && ge->extension == extensions.xinputOpcode)
+    {
+        pushXInputEvent(ge);
+    }
+    else if (extensions.presentOpcode &&
+             ge->extension == extensions.presentOpcode)
+    {
+        pushPresentEvent(ge);
+    }
+}
+
+void EventQueue::pushPresentEvent(const xcb_ge_generic_event_t* ge)
+{
+#if XWIN_XCB_PRESENT
+    if (ge->event_type != XCB_PRESENT_COMPLETE_NOTIFY)
+    {
+        return;
+    }
+
+    // The vblank a window asked for with request_paint() has started
+    const xcb_present_complete_notify_event_t* complete =
+        (const xcb_present_complete_notify_event_t*)ge;
+    Window* window = findWindow(complete->window);
+    if (!window || complete->kind != XCB_PRESENT_COMPLETE_KIND_NOTIFY_MSC ||
+        complete->serial != window->mPaintSerial)
+    {
+        return;
+    }
+
+    // Measure the refresh interval from successive notifications, this also
+    // follows software timed servers such as Xvfb
+    if (window->mLastMsc && complete->msc > window->mLastMsc)
+    {
+        window->mFrameInterval = (complete->ust - window->mLastUst) /
+                                 (complete->msc - window->mLastMsc);
+    }
+    window->mLastMsc = complete->msc;
+    window->mLastUst = complete->ust;
+    mWindows.flags(window->mHandle) &= ~WindowPool::PaintRequested;
+
+    // A frame presented now lands on the following vblank, assume 60Hz until
+    // an interval has been measured
+    uint64_t interval = window->mFrameInterval ? window->mFrameInterval : 16667;
+    // Generic events skip the flush in pushEvent, input batched before the
+    // vblank stays ahead of the Paint
+    flushBatched();
+    enqueue(Event(PaintData(complete->msc + 1, complete->ust + interval),
+                   window));
+#else
+    (void)ge;
+#endif
+}
+
+void EventQueue::pushXInputEvent(const xcb_ge_generic_event_t* ge)
+{
+#if XWIN_XCB_XINPUT
+    switch (ge->event_type)
+    {
+    case XCB_INPUT_RAW_MOTION:
+    {
+        if (!mPointerWindow)
+        {
+            break;
+        }
+
+        // Valuators 0 and 1 are the relative x and y axes, only the axes set
+        // in the mask have a value
+        const xcb_input_raw_motion_event_t* raw =
+            (const xcb_input_raw_motion_event_t*)ge;
+        const uint32_t* mask = xcb_input_raw_button_press_valuator_mask(raw);
+        const xcb_input_fp3232_t* values =
+            xcb_input_raw_button_press_axisvalues_raw(raw);
+        const unsigned axes = raw->valuators_len * 32u;
+        unsigned n = 0;
+        if (mRawPending)
+        {
+            countEvent(EventCount::Coalesced, EventType::MouseRaw);
+        }
+        for (unsigned axis = 0; axis < axes && axis < 2; ++axis)
+        {
+            if (!(mask[axis / 32] & (1u << (axis % 32))))
+            {
+                continue;
+            }
+            (axis == 0 ? mRawDeltaX : mRawDeltaY) += toDouble(values[n]);
+            mRawPending = true;
+            ++n;
+        }
+        break;
+    }
+    case XCB_INPUT_MOTION:
+    {
+        const xcb_input_motion_event_t* motion =
+            (const xcb_input_motion_event_t*)ge;
+        Window* window = findWindow(motion->event);
+        if (!window)
+        {
+            break;
+        }
+
+        bool control = motion->mods.effective & XCB_MOD_MASK_CONTROL;
+        bool shift = motion->mods.effective & XCB_MOD_MASK_SHIFT;
+        bool lock = motion->mods.effective & XCB_MOD_MASK_LOCK;
+        ModifierState mods = ModifierState(control, lock, shift, false);
+
+        int x = motion->event_x >> 16;
+        int y = motion->event_y >> 16;
+        if (window != mMotionWindow || x != mMotionX || y != mMotionY)
+        {
+            unsigned screenx = static_cast<unsigned>(motion->root_x >> 16);
+            unsigned screeny = static_cast<unsigned>(motion->root_y >> 16);
+            // The move follows the raw motion and wheel batched before it
+            flushRawMotion();
+            flushWheel();
+            enqueue(Event(MouseMoveData(static_cast<unsigned>(x),
+                                         static_cast<unsigned>(y), screenx,
+                                         screeny, 0, 0),
+                           window));
+            mMotionWindow = window;
+            mMotionX = x;
+            mMotionY = y;
+        }
+        else
+        {
+            // Same position, only the scroll valuators changed
+            countEvent(EventCount::Coalesced, EventType::MouseMove);
+        }
+
+        // Scroll valuators are absolute, the wheel delta is the distance
+        // from the previous value in units of one notch
+        std::vector<ScrollAxis>* scrollAxes = findScrollAxes(motion->sourceid);
+        if (!scrollAxes)
+        {
+            break;
+        }
+        const uint32_t* mask = xcb_input_button_press_valuator_mask(motion);
+        const xcb_input_fp3232_t* values =
+            xcb_input_button_press_axisvalues(motion);
+        const unsigned axes = motion->valuators_len * 32u;
+        double delta = 0.0;
+        double deltax = 0.0;
+        unsigned n = 0;
+        for (unsigned axis = 0; axis < axes; ++axis)
+        {
+            if (!(mask[axis / 32] & (1u << (axis % 32))))
+            {
+                continue;
+            }
+            double value = toDouble(values[n++]);
+            for (ScrollAxis& scroll : *scrollAxes)
+            {
+                if (scroll.number != axis)
+                {
+                    continue;
+                }
+                if (scroll.valid)
+                {
+                    double notches = (value - scroll.last) / scroll.increment;
+                    if (scroll.horizontal)
+                    {
+                        deltax += notches;
+                    }
+                    else
+                    {
+                        delta -= notches;
+                    }
+                }
+                scroll.last = value;
+                scroll.valid = true;
+            }
+        }
+        if (delta != 0.0 || deltax != 0.0)
+        {
+            pushWheel(window, mods, delta, deltax);
+        }
+        break;
+    }
+    case XCB_INPUT_BUTTON_PRESS:
+    case XCB_INPUT_BUTTON_RELEASE:
+    {
+        const xcb_input_button_press_event_t* bp =
+            (const xcb_input_button_press_event_t*)ge;
+        Window* window = findWindow(bp->event);
+        if (!window)
+        {
+            break;
+        }
+
+        // The motion events already report the scroll valuators these wheel
+        // buttons were emulated from, at full resolution. Devices whose axes
+        // are not known yet keep scrolling through the buttons.
+        const std::vector<ScrollAxis>* scrollAxes =
+            findScrollAxes(bp->sourceid);
+        if ((bp->flags & XCB_INPUT_POINTER_EVENT_FLAGS_POINTER_EMULATED) &&
+            scrollAxes && !scrollAxes->empty())
+        {
+            break;
+        }
+
+        bool control = bp->mods.effective & XCB_MOD_MASK_CONTROL;
+        bool shift = bp->mods.effective & XCB_MOD_MASK_SHIFT;
+        bool lock = bp->mods.effective & XCB_MOD_MASK_LOCK;
+        ModifierState mods = ModifierState(control, lock, shift, false);
+
+        ButtonState state = ge->event_type == XCB_INPUT_BUTTON_PRESS
+                                ? ButtonState::Pressed
+                                : ButtonState::Released;
+        pushButton(window, bp->detail, state, mods);
+        break;
+    }
+    case XCB_INPUT_TOUCH_BEGIN:
+    case XCB_INPUT_TOUCH_UPDATE:
+    case XCB_INPUT_TOUCH_END:
+    {
+        // The three touch events share a layout, detail is the touch id
+        const xcb_input_touch_begin_event_t* te =
+            (const xcb_input_touch_begin_event_t*)ge;
+        Window* window = findWindow(te->event);
+        if (!window)
+        {
+            break;
+        }
+
+        TouchPoint touch;
+        touch.id = te->detail;
+        touch.screenX = static_cast<unsigned>(te->root_x >> 16);
+        touch.screenY = static_cast<unsigned>(te->root_y >> 16);
+        touch.clientX = static_cast<unsigned>(te->event_x >> 16);
+        touch.clientY = static_cast<unsigned>(te->event_y >> 16);
+        touch.isChanged = true;
+
+        TouchState state = ge->event_type == XCB_INPUT_TOUCH_BEGIN
+                               ? TouchState::Began
+                           : ge->event_type == XCB_INPUT_TOUCH_END
+                               ? TouchState::Ended
+                               : TouchState::Moved;
+        pushTouch(window, touch, state);
+        break;
+    }
+    case XCB_INPUT_DEVICE_CHANGED:
+    {
+        // Axes are looked up by source device, so a master switching to
+        // another slave changes nothing. A device whose own classes changed
+        // has no scroll axes until the new ones are known.
+        const xcb_input_device_changed_event_t* changed =
+            (const xcb_input_device_changed_event_t*)ge;
+        if (changed->reason == XCB_INPUT_CHANGE_REASON_DEVICE_CHANGE)
+        {
+            mScrollDevices.erase(changed->sourceid);
+            queryScrollAxes(changed->sourceid);
+        }
+        break;
+    }
+    case XCB_INPUT_HIERARCHY:
+    {
+        // Devices were added, removed, enabled or disabled
+        queryScrollAxes(XCB_INPUT_DEVICE_ALL);
+        break;
+    }
+    default:
+        break;
+    }
+#else
+    (void)ge;
+#endif
+}
+
+void EventQueue::pushClientMessage(const xcb_client_message_event_t* cm)
+{
+    const XWinState& xwinState = getXWinState();
+    const AtomCache& atoms = xwinState.atoms;
+
+    // XDND messages are addressed to the window the files are over
+    const WindowHandle target = mWindows.find(cm->window);
+    if (target)
+    {
+        const Rect& rect = mWindows.rect(target);
+        if (mDragDrop.on_client_message(cm, mWindows.get(target), rect.x,
+                                        rect.y))
+        {
+            return;
+        }
+    }
+
+    if (cm->type != atoms[AtomId::WM_PROTOCOLS] || cm->format != 32)
+    {
+        return;
+    }
+
+    const xcb_atom_t protocol = cm->data.data32[0];
+    if (protocol == atoms[AtomId::WM_DELETE_WINDOW])
+    {
+        enqueue(Event(EventType::Close, findWindow(cm->window)));
+    }
+    else if (protocol == atoms[AtomId::NET_WM_PING])
+    {
+        // Answer the window manager's liveness check by bouncing the message
+        // back to the root window
+        xcb_window_t root = xwinState.screen->root;
+        xcb_client_message_event_t pong = *cm;
+        pong.window = root;
+        xcb_send_event(xwinState.connection, 0, root,
+                       XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY |
+                           XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT,
+                       reinterpret_cast<const char*>(&pong));
+    }
+    else if (protocol == atoms[AtomId::NET_WM_SYNC_REQUEST])
+    {
+        // The configure that follows is acknowledged with this value once
+        // it has been drawn
+        Window* window = findWindow(cm->window);
+        if (window && window->mSyncCounter)
+        {
+            window->mSyncValue =
+                (static_cast<uint64_t>(cm->data.data32[3]) << 32) |
+                cm->data.data32[2];
+            window->mSyncRequested = true;
+        }
+    }
+}
+
 Key getKey(xcb_keycode_t detail)
 {
     Key d = Key::KeysMax;
@@ -46,133 +920,274 @@ Key getKey(xcb_keycode_t detail)
     return d;
 }
 
+/**
+ * Events that may be reordered after batched motion and wheel input. Core
+ * buttons 4 to 7 are wheel notches.
+ */
+bool isBatchable(const xcb_generic_event_t* event)
+{
+    switch (event->response_type & 0x7f)
+    {
+    case XCB_MOTION_NOTIFY:
+    case XCB_GE_GENERIC:
+        return true;
+    case XCB_CLIENT_MESSAGE:
+        // File drag positions are coalesced like pointer motion
+        return ((const xcb_client_message_event_t*)event)->type ==
+               getXWinState().atoms[AtomId::XDND_POSITION];
+    case XCB_BUTTON_PRESS:
+    case XCB_BUTTON_RELEASE:
+    {
+        xcb_button_t button = ((const xcb_button_press_event_t*)event)->detail;
+        return button >= 4 && button <= 7;
+    }
+    default:
+        return false;
+    }
+}
+
 void EventQueue::pushEvent(const xcb_generic_event_t* event)
 {
     Window* window = nullptr;
     uint8_t event_code = event->response_type & 0x7f;
 
+    // Errors of unchecked requests, checked ones are resolved by mRequests
+    if (event->response_type == 0)
+    {
+        mRequests.report((const xcb_generic_error_t*)event);
+        return;
+    }
+
+#if XWIN_XCB_RANDR
+    // Output layout changes, handled once at the end of update
+    const uint8_t randrFirstEvent = getXWinState().extensions.randrFirstEvent;
+    if (randrFirstEvent &&
+        (event_code == randrFirstEvent + XCB_RANDR_SCREEN_CHANGE_NOTIFY ||
+         event_code == randrFirstEvent + XCB_RANDR_NOTIFY))
+    {
+        mDisplaysDirty = true;
+        return;
+    }
+#endif
+
+#if XWIN_XCB_SHM
+    // The server is done reading a framebuffer, it is not user visible
+    const Extensions& extensions = getXWinState().extensions;
+    if (extensions.shm &&
+        event_code == extensions.shmFirstEvent + XCB_SHM_COMPLETION)
+    {
+        const xcb_shm_completion_event_t* completion =
+            (const xcb_shm_completion_event_t*)event;
+        window = findWindow(completion->drawable);
+        if (window)
+        {
+            window->mFramebuffer.complete(completion->shmseg);
+        }
+        return;
+    }
+#endif
+
+    // Keep batched motion and wheel input ordered before any other event
+    if (!isBatchable(event))
+    {
+        flushBatched();
+    }
+
     Event e = Event(EventType::None, window);
 
     switch (event_code)
     {
     case XCB_CONFIGURE_NOTIFY:
     {
-        e = Event(EventType::Create, window);
+        xcb_configure_notify_event_t* configure =
+            (xcb_configure_notify_event_t*)event;
+        window = findWindow(configure->window);
+        if (!window)
+        {
+            break;
+        }
+
+        // Positions are in root coordinates when the window manager sends
+        // them or while we are not inside a frame window
+        Rect& rect = mWindows.rect(window->mHandle);
+        if ((event->response_type & 0x80) ||
+            !(mWindows.flags(window->mHandle) & WindowPool::Reparented))
+        {
+            rect.x = configure->x;
+            rect.y = configure->y;
+        }
+
+        // Configures preceded by a sync request come from an interactive
+        // resize, the window manager holds the next one until we ack
+        const bool resizing = window->mSyncRequested;
+        if (resizing)
+        {
+            window->mSyncRequested = false;
+            if (std::find(mSyncAcks.begin(), mSyncAcks.end(), window) ==
+                mSyncAcks.end())
+            {
+                mSyncAcks.push_back(window);
+            }
+        }
+        if (configure->width != rect.width || configure->height != rect.height)
+        {
+            rect.width = configure->width;
+            rect.height = configure->height;
+            e = Event(
+                ResizeData(configure->width, configure->height, resizing),
+                window);
+        }
+        updateDpi(window);
+        break;
+    }
+    case XCB_REPARENT_NOTIFY:
+    {
+        xcb_reparent_notify_event_t* reparent =
+            (xcb_reparent_notify_event_t*)event;
+        window = findWindow(reparent->window);
+        if (window)
+        {
+            uint8_t& flags = mWindows.flags(window->mHandle);
+            if (reparent->parent != getXWinState().screen->root)
+            {
+                flags |= WindowPool::Reparented;
+            }
+            else
+            {
+                flags &= ~WindowPool::Reparented;
+            }
+        }
+        break;
+    }
+    case XCB_PROPERTY_NOTIFY:
+    {
+        // Xft.dpi lives in the root window's resource database
+        xcb_property_notify_event_t* property =
+            (xcb_property_notify_event_t*)event;
+        if (property->window == getXWinState().screen->root &&
+            property->atom == XCB_ATOM_RESOURCE_MANAGER)
+        {
+            mDisplaysDirty = true;
+        }
+        else
+        {
+            // Deletions and new values pace INCR selection transfers
+            mClipboard.on_property_notify(property);
+        }
+        break;
+    }
+    case XCB_SELECTION_NOTIFY:
+    {
+        mClipboard.on_selection_notify(
+            (const xcb_selection_notify_event_t*)event);
+        break;
+    }
+    case XCB_SELECTION_REQUEST:
+    {
+        mClipboard.on_selection_request(
+            (const xcb_selection_request_event_t*)event);
+        break;
+    }
+    case XCB_SELECTION_CLEAR:
+    {
+        mClipboard.on_selection_clear(
+            (const xcb_selection_clear_event_t*)event);
         break;
     }
     case XCB_EXPOSE:
     {
         xcb_expose_event_t* expose = (xcb_expose_event_t*)event;
-        e = Event(ResizeData(expose->width, expose->height, true), window);
+        window = findWindow(expose->window);
+        if (!window)
+        {
+            break;
+        }
+
+        // count is the number of exposes still to follow, repaint once
+        // after the last one with everything they uncovered
+        window->mDamage.add(
+            Rect(expose->x, expose->y, expose->width, expose->height));
+        if (expose->count == 0)
+        {
+            PaintData paint;
+            paint.rectCount =
+                window->mDamage.copyTo(paint.rects, PaintData::maxRects);
+            window->mDamage.clear();
+            e = Event(paint, window);
+        }
         break;
     }
     case XCB_RESIZE_REQUEST:
     {
         xcb_resize_request_event_t* resize = (xcb_resize_request_event_t*)event;
+        window = findWindow(resize->window);
         e = Event(ResizeData(resize->width, resize->height, false), window);
         break;
     }
     case XCB_ENTER_NOTIFY:
     {
+        xcb_enter_notify_event_t* enter = (xcb_enter_notify_event_t*)event;
+        window = findWindow(enter->event);
+        if (window)
+        {
+            mPointerWindow = window;
+        }
+
+        // Scroll valuators may have moved while the pointer was elsewhere
+        for (auto& device : mScrollDevices)
+        {
+            for (ScrollAxis& axis : device.second)
+            {
+                axis.valid = false;
+            }
+        }
         e = Event(FocusData(true), window);
         break;
     }
     case XCB_LEAVE_NOTIFY:
     {
+        xcb_leave_notify_event_t* leave = (xcb_leave_notify_event_t*)event;
+        window = findWindow(leave->event);
         e = Event(FocusData(false), window);
         break;
     }
+    case XCB_GE_GENERIC:
+    {
+        pushGenericEvent((const xcb_ge_generic_event_t*)event);
+        break;
+    }
     case XCB_CLIENT_MESSAGE:
     {
-        // Maximize / Minimize...
+        pushClientMessage((const xcb_client_message_event_t*)event);
         break;
     }
     case XCB_BUTTON_PRESS:
+    case XCB_BUTTON_RELEASE:
     {
-        xcb_button_press_event_t* bp = (xcb_button_press_event_t*)event;
+        // Press and release share a layout, detail is the button number
+        const xcb_button_press_event_t* bp =
+            (const xcb_button_press_event_t*)event;
+        window = findWindow(bp->event);
 
         bool control = bp->state & XCB_MOD_MASK_CONTROL;
         bool shift = bp->state & XCB_MOD_MASK_SHIFT;
         bool lock = bp->state & XCB_MOD_MASK_LOCK;
         ModifierState mods = ModifierState(control, lock, shift, false);
 
-        if (bp->state & XCB_BUTTON_MASK_1)
-        {
-            mQueue.emplace(
-                MouseInputData(MouseInput::Left, ButtonState::Pressed, mods),
-                window);
-        }
-        if (bp->state & XCB_BUTTON_MASK_2)
-        {
-            mQueue.emplace(
-                MouseInputData(MouseInput::Right, ButtonState::Pressed, mods),
-                window);
-        }
-        if (bp->state & XCB_BUTTON_MASK_3)
-        {
-            mQueue.emplace(
-                MouseInputData(MouseInput::Middle, ButtonState::Pressed, mods),
-                window);
-        }
-        if (bp->state & XCB_BUTTON_MASK_4)
-        {
-            mQueue.emplace(
-                MouseInputData(MouseInput::Button4, ButtonState::Pressed, mods),
-                window);
-        }
-        if (bp->state & XCB_BUTTON_MASK_5)
-        {
-            mQueue.emplace(
-                MouseInputData(MouseInput::Button5, ButtonState::Pressed, mods),
-                window);
-        }
-        break;
-    }
-    case XCB_BUTTON_RELEASE:
-    {
-        xcb_button_release_event_t* br = (xcb_button_release_event_t*)event;
-
-        bool control = br->state & XCB_MOD_MASK_CONTROL;
-        bool shift = br->state & XCB_MOD_MASK_SHIFT;
-        bool lock = br->state & XCB_MOD_MASK_LOCK;
-        ModifierState mods = ModifierState(control, lock, shift, false);
-
-        if (br->state & XCB_BUTTON_MASK_1)
-        {
-            mQueue.emplace(
-                MouseInputData(MouseInput::Left, ButtonState::Pressed, mods),
-                window);
-        }
-        if (br->state & XCB_BUTTON_MASK_2)
-        {
-            mQueue.emplace(
-                MouseInputData(MouseInput::Right, ButtonState::Pressed, mods),
-                window);
-        }
-        if (br->state & XCB_BUTTON_MASK_3)
-        {
-            mQueue.emplace(
-                MouseInputData(MouseInput::Middle, ButtonState::Pressed, mods),
-                window);
-        }
-        if (br->state & XCB_BUTTON_MASK_4)
-        {
-            mQueue.emplace(
-                MouseInputData(MouseInput::Button4, ButtonState::Pressed, mods),
-                window);
-        }
-        if (br->state & XCB_BUTTON_MASK_5)
-        {
-            mQueue.emplace(
-                MouseInputData(MouseInput::Button5, ButtonState::Pressed, mods),
-                window);
-        }
+        ButtonState state = event_code == XCB_BUTTON_PRESS
+                                ? ButtonState::Pressed
+                                : ButtonState::Released;
+        pushButton(window, bp->detail, state, mods);
         break;
     }
     case XCB_MOTION_NOTIFY:
     {
         xcb_motion_notify_event_t* motion = (xcb_motion_notify_event_t*)event;
+        window = findWindow(motion->event);
 
+        // Wheel notches batched before the move stay ahead of it
+        flushRawMotion();
+        flushWheel();
         e = Event(MouseMoveData(motion->event_x, motion->event_y,
                                 motion->root_x, motion->root_y, 0, 0),
                   window);
@@ -181,6 +1196,7 @@ void EventQueue::pushEvent(const xcb_generic_event_t* event)
     case XCB_KEY_PRESS:
     {
         const xcb_key_press_event_t* key = (xcb_key_press_event_t*)event;
+        window = findWindow(key->event);
 
         bool control = key->state & XCB_MOD_MASK_CONTROL;
         bool shift = key->state & XCB_MOD_MASK_SHIFT;
@@ -195,6 +1211,7 @@ void EventQueue::pushEvent(const xcb_generic_event_t* event)
     {
         const xcb_key_release_event_t* key =
             (const xcb_key_release_event_t*)event;
+        window = findWindow(key->event);
 
         bool control = key->state & XCB_MOD_MASK_CONTROL;
         bool shift = key->state & XCB_MOD_MASK_SHIFT;
@@ -212,7 +1229,7 @@ void EventQueue::pushEvent(const xcb_generic_event_t* event)
     }
     if (e.type != EventType::None)
     {
-        mQueue.emplace(e);
+        enqueue(e);
     }
 }
 }
\ No newline at end of file
@@ -1,10 +1,16 @@
 #pragma once
 
 #include "../Common/Event.h"
+#include "../Common/EventBuffer.h"
+#include "../Common/WindowPool.h"
+#include "XCBClipboard.h"
+#include "XCBDragDrop.h"
+#include "XCBRequests.h"
 
 #include <xcb/xcb.h>
 
-#include <queue>
+#include <unordered_map>
+#include <vector>
 
 namespace xwin
 {
@@ -18,6 +24,8 @@ namespace xwin
     public:
         EventQueue();
 
+        ~EventQueue();
+
         void update();
 
         const Event &front();
@@ -26,9 +34,153 @@ namespace xwin
 
         bool empty();
 
+        // Caps the events held between updates, 0 (the default) for no limit.
+        // Keys, buttons and Close are always queued, see OverflowPolicy
+        void setCapacity(size_t capacity, OverflowPolicy policy);
+
+        // Lossy events dropped or coalesced because of the capacity
+        const EventBufferStats& getOverflowStats() const;
+
+        // Touch points currently down, as of the last decoded touch event
+        const std::vector<TouchPoint>& getTouches() const;
+
+        // CLIPBOARD and PRIMARY, transfers progress during update
+        Clipboard& getClipboard();
+
+        // Replies and errors of requests in flight, resolved during update
+        Requests& getRequests();
+
+        // The window an event's handle names, null once it was destroyed
+        Window* getWindow(WindowHandle handle) const;
+
+        friend struct Window;
+
     protected:
+        // Queues an event stamped with the handle of its window
+        void enqueue(Event event);
+
         void pushEvent(const xcb_generic_event_t* e);
 
-        std::queue<Event> mQueue;
+        void pushClientMessage(const xcb_client_message_event_t* e);
+
+        void pushGenericEvent(const xcb_ge_generic_event_t* e);
+
+        void pushXInputEvent(const xcb_ge_generic_event_t* e);
+
+        void pushPresentEvent(const xcb_ge_generic_event_t* e);
+
+        // Core and XInput button presses, buttons 4 to 7 are wheel notches
+        void pushButton(Window* window, uint32_t button, ButtonState state,
+                        ModifierState modifiers);
+
+        // Accumulates wheel motion, emitted once per window by flushWheel
+        void pushWheel(Window* window, ModifierState modifiers, double delta,
+                       double deltax);
+
+        // Updates the active touch set, moves are coalesced per touch point
+        // until flushTouches
+        void pushTouch(Window* window, const TouchPoint& touch,
+                       TouchState state);
+
+        // Emits everything batched so far, keeping it ordered before the
+        // event being decoded
+        void flushBatched();
+
+        // Emits the raw motion accumulated since the last flush as one event
+        void flushRawMotion();
+
+        void flushWheel();
+
+        void flushTouches();
+
+        // XInput 2.1 scroll valuator of a pointer device
+        struct ScrollAxis
+        {
+            uint16_t number;
+            bool horizontal;
+            double increment;
+            double last;
+            bool valid;
+        };
+
+        // Asks for the scroll axes of a device, or of every device with
+        // XCB_INPUT_DEVICE_ALL. The reply is read during a later update
+        void queryScrollAxes(uint16_t deviceid);
+
+        // Scroll axes of a source device, null until its query is answered
+        std::vector<ScrollAxis>* findScrollAxes(uint16_t deviceid);
+
+        WindowHandle addWindow(xcb_window_t id, Window* window);
+
+        void removeWindow(xcb_window_t id);
+
+        Window* findWindow(xcb_window_t id) const;
+
+        // Emits a DPI event if the window moved to an output of another scale
+        void updateDpi(Window* window);
+
+        // Emits the latest file drag position, once per update
+        void flushHover();
+
+        // Blocks until an event arrives or a pending reply does, which
+        // xcb_wait_for_event would not wake for
+        xcb_generic_event_t* waitForEventOrReply(xcb_connection_t* connection);
+
+        EventBuffer mQueue;
+
+        Requests mRequests;
+
+        Clipboard mClipboard;
+
+        // XDND target for every window, drops stream through mClipboard
+        DragDrop mDragDrop;
+
+        // Windows created with this queue, found by X11 id for routing
+        WindowPool mWindows;
+
+        // Windows waiting on a Paint without Present timing, served on the
+        // next update
+        std::vector<Window*> mPaintRequests;
+
+        // Windows whose _NET_WM_SYNC_REQUEST frame was handed to the
+        // application, acknowledged at the start of the next update
+        std::vector<Window*> mSyncAcks;
+
+        // RandR or Xft.dpi reported a change, the display snapshot is
+        // refreshed once at the end of the update
+        bool mDisplaysDirty = false;
+
+        // Window the pointer last entered, raw motion is reported to it
+        Window* mPointerWindow = nullptr;
+
+        // XInput 2 raw motion batched between flushes
+        double mRawDeltaX = 0.0;
+        double mRawDeltaY = 0.0;
+        bool mRawPending = false;
+        bool mRawSelected = false;
+
+        // Wheel motion coalesced between flushes
+        Window* mWheelWindow = nullptr;
+        ModifierState mWheelModifiers;
+        double mWheelDelta = 0.0;
+        double mWheelDeltaX = 0.0;
+        bool mWheelPending = false;
+
+        // XInput 2.1 scroll axes by source device. Wheel buttons the server
+        // emulates from these are duplicates, devices without any entry
+        // scroll through their buttons
+        std::unordered_map<uint16_t, std::vector<ScrollAxis>> mScrollDevices;
+
+        // Active touches and the window each one began in
+        std::vector<TouchPoint> mTouches;
+        std::vector<Window*> mTouchWindows;
+
+        // Touch moves coalesced between flushes, at most one per touch point
+        std::vector<std::pair<Window*, TouchPoint>> mTouchMoves;
+
+        // Last XInput pointer position, scroll-only motion is not a move
+        Window* mMotionWindow = nullptr;
+        int mMotionX = 0;
+        int mMotionY = 0;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,188 @@
+#include "XCBExtensions.h"
+#include "../Common/RoundTrips.h"
+
+#include <stdlib.h>
+
+#if XWIN_XCB_XINPUT
+#include <xcb/xinput.h>
+#endif
+#if XWIN_XCB_PRESENT
+#include <xcb/present.h>
+#endif
+#if XWIN_XCB_SHM
+#include <xcb/shm.h>
+#endif
+#if XWIN_XCB_SYNC
+#include <xcb/sync.h>
+#endif
+#if XWIN_XCB_RANDR
+#include <xcb/randr.h>
+#endif
+#if XWIN_XCB_RENDER
+#include <xcb/render.h>
+#endif
+#if XWIN_XCB_XFIXES
+#include <xcb/xfixes.h>
+#endif
+
+namespace xwin {
+
+auto Extensions::prefetch(xcb_connection_t* connection) -> void {
+	// BIG-REQUESTS, enabled by the first maximum request length query
+	xcb_prefetch_maximum_request_length(connection);
+#if XWIN_XCB_XINPUT
+	xcb_prefetch_extension_data(connection, &xcb_input_id);
+#endif
+#if XWIN_XCB_PRESENT
+	xcb_prefetch_extension_data(connection, &xcb_present_id);
+#endif
+#if XWIN_XCB_SHM
+	xcb_prefetch_extension_data(connection, &xcb_shm_id);
+#endif
+#if XWIN_XCB_SYNC
+	xcb_prefetch_extension_data(connection, &xcb_sync_id);
+#endif
+#if XWIN_XCB_RANDR
+	xcb_prefetch_extension_data(connection, &xcb_randr_id);
+#endif
+#if XWIN_XCB_RENDER
+	xcb_prefetch_extension_data(connection, &xcb_render_id);
+#endif
+#if XWIN_XCB_XFIXES
+	xcb_prefetch_extension_data(connection, &xcb_xfixes_id);
+#endif
+}
+
+auto Extensions::resolve(xcb_connection_t* connection) -> void {
+	// Send every version request before waiting on any of them
+#if XWIN_XCB_XINPUT
+	const xcb_query_extension_reply_t* xinput = xcb_get_extension_data(connection, &xcb_input_id);
+	xcb_input_xi_query_version_cookie_t xinputCookie = {};
+	if (xinput && xinput->present) {
+		xinputCookie = xcb_input_xi_query_version(connection, 2, 2);
+	}
+#endif
+#if XWIN_XCB_PRESENT
+	const xcb_query_extension_reply_t* present = xcb_get_extension_data(connection, &xcb_present_id);
+	xcb_present_query_version_cookie_t presentCookie = {};
+	if (present && present->present) {
+		presentCookie = xcb_present_query_version(connection, 1, 0);
+	}
+#endif
+#if XWIN_XCB_SHM
+	const xcb_query_extension_reply_t* shmExtension = xcb_get_extension_data(connection, &xcb_shm_id);
+	xcb_shm_query_version_cookie_t shmCookie = {};
+	if (shmExtension && shmExtension->present) {
+		shmCookie = xcb_shm_query_version(connection);
+	}
+#endif
+#if XWIN_XCB_SYNC
+	const xcb_query_extension_reply_t* syncExtension = xcb_get_extension_data(connection, &xcb_sync_id);
+	xcb_sync_initialize_cookie_t syncCookie = {};
+	if (syncExtension && syncExtension->present) {
+		syncCookie = xcb_sync_initialize(connection, 3, 1);
+	}
+#endif
+#if XWIN_XCB_RANDR
+	const xcb_query_extension_reply_t* randr = xcb_get_extension_data(connection, &xcb_randr_id);
+	xcb_randr_query_version_cookie_t randrCookie = {};
+	if (randr && randr->present) {
+		randrCookie = xcb_randr_query_version(connection, 1, 5);
+	}
+#endif
+#if XWIN_XCB_RENDER
+	const xcb_query_extension_reply_t* render = xcb_get_extension_data(connection, &xcb_render_id);
+	xcb_render_query_version_cookie_t renderCookie = {};
+	xcb_render_query_pict_formats_cookie_t formatsCookie = {};
+	if (render && render->present) {
+		renderCookie = xcb_render_query_version(connection, 0, 11);
+		formatsCookie = xcb_render_query_pict_formats(connection);
+	}
+#endif
+#if XWIN_XCB_XFIXES
+	const xcb_query_extension_reply_t* xfixesExtension = xcb_get_extension_data(connection, &xcb_xfixes_id);
+	xcb_xfixes_query_version_cookie_t xfixesCookie = {};
+	if (xfixesExtension && xfixesExtension->present) {
+		xfixesCookie = xcb_xfixes_query_version(connection, 4, 0);
+	}
+#endif
+
+	XWIN_ROUND_TRIP_SCOPE();
+	// Later calls return the cached length without a round trip
+	maxRequestBytes = static_cast<size_t>(xcb_get_maximum_request_length(connection)) * 4;
+#if XWIN_XCB_XINPUT
+	if (xinputCookie.sequence) {
+		xcb_input_xi_query_version_reply_t* reply = xcb_input_xi_query_version_reply(connection, xinputCookie, nullptr);
+		if (reply && reply->major_version >= 2) {
+			xinputOpcode = xinput->major_opcode;
+			xinputMinor = reply->minor_version;
+		}
+		free(reply);
+	}
+#endif
+#if XWIN_XCB_PRESENT
+	if (presentCookie.sequence) {
+		xcb_present_query_version_reply_t* reply = xcb_present_query_version_reply(connection, presentCookie, nullptr);
+		if (reply) {
+			presentOpcode = present->major_opcode;
+		}
+		free(reply);
+	}
+#endif
+#if XWIN_XCB_SHM
+	if (shmCookie.sequence) {
+		xcb_shm_query_version_reply_t* reply = xcb_shm_query_version_reply(connection, shmCookie, nullptr);
+		if (reply) {
+			shm = true;
+			shmFirstEvent = shmExtension->first_event;
+		}
+		free(reply);
+	}
+#endif
+#if XWIN_XCB_SYNC
+	if (syncCookie.sequence) {
+		xcb_sync_initialize_reply_t* reply = xcb_sync_initialize_reply(connection, syncCookie, nullptr);
+		sync = reply != nullptr;
+		free(reply);
+	}
+#endif
+#if XWIN_XCB_RANDR
+	if (randrCookie.sequence) {
+		xcb_randr_query_version_reply_t* reply = xcb_randr_query_version_reply(connection, randrCookie, nullptr);
+		if (reply && reply->major_version == 1 && reply->minor_version >= 3) {
+			randrFirstEvent = randr->first_event;
+			randrMinor = reply->minor_version;
+		}
+		free(reply);
+	}
+#endif
+#if XWIN_XCB_RENDER
+	if (renderCookie.sequence) {
+		xcb_render_query_version_reply_t* version = xcb_render_query_version_reply(connection, renderCookie, nullptr);
+		xcb_render_query_pict_formats_reply_t* formats = xcb_render_query_pict_formats_reply(connection, formatsCookie, nullptr);
+		// Cursors from pictures need RENDER 0.5
+		if (version && formats && (version->major_version > 0 || version->minor_version >= 5)) {
+			for (xcb_render_pictforminfo_iterator_t format = xcb_render_query_pict_formats_formats_iterator(formats); format.rem;
+				 xcb_render_pictforminfo_next(&format)) {
+				const xcb_render_directformat_t& direct = format.data->direct;
+				if (format.data->type == XCB_RENDER_PICT_TYPE_DIRECT && format.data->depth == 32 && direct.alpha_mask == 0xff &&
+					direct.alpha_shift == 24 && direct.red_shift == 16 && direct.green_shift == 8 && direct.blue_shift == 0) {
+					renderArgbFormat = format.data->id;
+					break;
+				}
+			}
+		}
+		free(version);
+		free(formats);
+	}
+#endif
+#if XWIN_XCB_XFIXES
+	if (xfixesCookie.sequence) {
+		xcb_xfixes_query_version_reply_t* reply = xcb_xfixes_query_version_reply(connection, xfixesCookie, nullptr);
+		xfixes = reply && reply->major_version >= 4;
+		free(reply);
+	}
+#endif
+}
+
+} // namespace xwin
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+namespace xwin {
+
+/**
+ * Optional X11 extensions negotiated at init. Extensions compiled out
+ * (see xwin_find_xcb_extension) or missing on the server stay zeroed.
+ */
+struct Extensions {
+	// XInput major opcode, used to recognise its generic events. 0 if XInput 2 is unavailable
+	uint8_t xinputOpcode = 0;
+	// Negotiated XInput 2 minor version
+	uint16_t xinputMinor = 0;
+	// Present major opcode, used to recognise its generic events. 0 if unavailable
+	uint8_t presentOpcode = 0;
+	// Whether MIT-SHM is available, and the code of its first event
+	bool shm = false;
+	uint8_t shmFirstEvent = 0;
+	// Whether the SYNC extension is available, windows then take part in _NET_WM_SYNC_REQUEST
+	bool sync = false;
+	// RandR first event code and negotiated minor version, 0 unless RandR 1.3 or later is available
+	uint8_t randrFirstEvent = 0;
+	uint32_t randrMinor = 0;
+	// RENDER's 32 bit ARGB picture format, which ARGB cursors are made from. 0 if RENDER is unavailable
+	uint32_t renderArgbFormat = 0;
+	// Whether XFixes 4 or later is available, cursors are then hidden without a blank cursor
+	bool xfixes = false;
+	// Largest request the server accepts in bytes, raised by BIG-REQUESTS when it has it
+	size_t maxRequestBytes = 0;
+
+	// Sends QueryExtension requests, call before any other init traffic so they share its round trip
+	auto prefetch(xcb_connection_t* connection) -> void;
+	// Collects the prefetched extensions and negotiates their versions in one burst
+	auto resolve(xcb_connection_t* connection) -> void;
+
+	[[nodiscard]] auto has_xinput(uint16_t minor = 0) const -> bool { return xinputOpcode && xinputMinor >= minor; }
+};
+
+} // namespace xwin
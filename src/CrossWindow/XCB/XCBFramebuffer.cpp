@@ -0,0 +1,356 @@
+#include "XCBFramebuffer.h"
+#include "../Common/Counters.h"
+#include "../Common/PixelConvert.h"
+#include "../Common/RoundTrips.h"
+#include "../Common/Window.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+#if XWIN_XCB_SHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <xcb/shm.h>
+#endif
+
+namespace xwin {
+
+namespace {
+
+// Stale region lists longer than this are replaced by the whole buffer
+constexpr size_t kMaxStaleRects = 32;
+
+// Size of a PutImage request without its pixel data
+constexpr uint32_t kPutImageHeaderBytes = 24;
+
+#if XWIN_XCB_SHM
+// Whether MIT-SHM attaches work on the connection, the first framebuffer to
+// attach a segment finds out for every other
+enum class ShmAttach { Unknown, Works, Fails };
+ShmAttach sShmAttach = ShmAttach::Unknown;
+#endif
+
+auto find_root_visual(const xcb_screen_t* screen) -> const xcb_visualtype_t* {
+	for (xcb_depth_iterator_t depth = xcb_screen_allowed_depths_iterator(screen); depth.rem; xcb_depth_next(&depth)) {
+		for (xcb_visualtype_iterator_t visual = xcb_depth_visuals_iterator(depth.data); visual.rem; xcb_visualtype_next(&visual)) {
+			if (visual.data->visual_id == screen->root_visual) {
+				return visual.data;
+			}
+		}
+	}
+	return nullptr;
+}
+
+auto clip(const Rect& rect, unsigned width, unsigned height, Rect* out) -> bool {
+	const int x0 = std::max(rect.x, 0);
+	const int y0 = std::max(rect.y, 0);
+	const int x1 = std::min(rect.x + static_cast<int>(rect.width), static_cast<int>(width));
+	const int y1 = std::min(rect.y + static_cast<int>(rect.height), static_cast<int>(height));
+	if (x1 <= x0 || y1 <= y0) {
+		return false;
+	}
+	*out = Rect(x0, y0, static_cast<unsigned>(x1 - x0), static_cast<unsigned>(y1 - y0));
+	return true;
+}
+
+} // namespace
+
+Framebuffer::~Framebuffer() {
+	release();
+}
+
+auto Framebuffer::init(Window* window) -> void {
+	const XWinState& xwinState = getXWinState();
+	mWindow = window;
+	mConnection = xwinState.connection;
+	mDepth = xwinState.screen->root_depth;
+	mFormat = Format::Unsupported;
+
+	// The kernels write little endian pixels and assume the usual channel masks of each depth
+	const xcb_setup_t* setup = xcb_get_setup(mConnection);
+	const xcb_visualtype_t* visual = find_root_visual(xwinState.screen);
+	if (visual && visual->_class == XCB_VISUAL_CLASS_TRUE_COLOR && setup->image_byte_order == XCB_IMAGE_ORDER_LSB_FIRST) {
+		for (xcb_format_iterator_t format = xcb_setup_pixmap_formats_iterator(setup); format.rem; xcb_format_next(&format)) {
+			if (format.data->depth != mDepth) {
+				continue;
+			}
+			mBitsPerPixel = format.data->bits_per_pixel;
+			mScanlinePad = format.data->scanline_pad;
+			if (mBitsPerPixel == 32 && visual->red_mask == 0xFF0000) {
+				mFormat = mDepth == 32 ? Format::Premultiplied : Format::Native;
+			} else if (mBitsPerPixel == 32 && visual->red_mask == 0x3FF00000) {
+				mFormat = Format::X2Rgb10;
+			} else if (mBitsPerPixel == 16 && visual->red_mask == 0xF800) {
+				mFormat = Format::Rgb565;
+			}
+			break;
+		}
+	}
+	// Converted formats go through PutImage so the caller's buffers stay in one layout
+	mUseShm = xwinState.extensions.shm && mFormat == Format::Native;
+#if XWIN_XCB_SHM
+	mUseShm = mUseShm && sShmAttach != ShmAttach::Fails;
+#endif
+	mGc = xcb_generate_id(mConnection);
+	xcb_create_gc(mConnection, mGc, window->mXcbWindowId, 0, nullptr);
+}
+
+auto Framebuffer::release() -> void {
+	if (!mConnection) {
+		return;
+	}
+	free_slot(mSlots[0]);
+	free_slot(mSlots[1]);
+	xcb_free_gc(mConnection, mGc);
+	mGc = 0;
+	mLocked = -1;
+	mWindow = nullptr;
+	mConnection = nullptr;
+}
+
+auto Framebuffer::lock() -> Buffer {
+	if (!mWindow || mFormat == Format::Unsupported) {
+		return {};
+	}
+	const Rect rect = mWindow->rect();
+	const unsigned width = rect.width;
+	const unsigned height = rect.height;
+	if (width == 0 || height == 0) {
+		return {};
+	}
+
+	// Heap buffers are copied out by PutImage before it returns, one is enough.
+	// Shared buffers alternate so we draw into one while the server reads the other.
+	int index = 0;
+	if (mUseShm) {
+		index = 1 - mLastPresented;
+		if (mSlots[index].busy) {
+			index = mLastPresented;
+		}
+	}
+	Slot& slot = mSlots[index];
+	if (slot.busy) {
+		return {};
+	}
+
+	if (slot.width != width || slot.height != height) {
+		if (!allocate(slot, width, height)) {
+			return {};
+		}
+		// A new second buffer starts from the frame the other one presented at this size
+		const Slot& other = mSlots[1 - index];
+		if (1 - index == mLastPresented && other.pixels && other.width == width && other.height == height) {
+			memcpy(slot.pixels, other.pixels, static_cast<size_t>(width) * height * sizeof(uint32_t));
+		}
+	} else if (!slot.stale.empty()) {
+		// Bring this buffer up to date with what the other one presented
+		const Slot& other = mSlots[1 - index];
+		if (other.width == width && other.height == height) {
+			for (const Rect& rect : slot.stale) {
+				for (unsigned y = 0; y < rect.height; ++y) {
+					const size_t offset = static_cast<size_t>(rect.y + y) * width + rect.x;
+					memcpy(slot.pixels + offset, other.pixels + offset, rect.width * sizeof(uint32_t));
+				}
+			}
+		}
+	}
+	slot.stale.clear();
+
+	mLocked = index;
+	Buffer buffer;
+	buffer.pixels = slot.pixels;
+	buffer.width = width;
+	buffer.height = height;
+	buffer.stride = width;
+	return buffer;
+}
+
+auto Framebuffer::present(const Rect* rects, size_t count) -> void {
+	if (mLocked < 0) {
+		return;
+	}
+	const int index = mLocked;
+	mLocked = -1;
+	Slot& slot = mSlots[index];
+	Slot& other = mSlots[1 - index];
+
+	const Rect all(0, 0, slot.width, slot.height);
+	if (count == 0) {
+		rects = &all;
+		count = 1;
+	}
+
+	// Only the last request of a shared memory frame asks for a completion event
+	size_t last = count;
+	Rect clipped;
+	for (size_t i = count; i-- > 0;) {
+		if (clip(rects[i], slot.width, slot.height, &clipped)) {
+			last = i;
+			break;
+		}
+	}
+	if (last == count) {
+		return;
+	}
+
+	for (size_t i = 0; i <= last; ++i) {
+		if (!clip(rects[i], slot.width, slot.height, &clipped)) {
+			continue;
+		}
+		put(slot, clipped, i == last);
+		if (mUseShm) {
+			other.stale.push_back(clipped);
+		}
+	}
+	if (other.stale.size() > kMaxStaleRects) {
+		other.stale.assign(1, all);
+	}
+	if (slot.shmseg) {
+		slot.busy = true;
+	}
+	mLastPresented = index;
+	xcb_flush(mConnection);
+	xwin::count(Counter::Flushes);
+}
+
+auto Framebuffer::put(const Slot& slot, const Rect& rect, bool last) -> void {
+	const xcb_window_t window = mWindow->mXcbWindowId;
+#if XWIN_XCB_SHM
+	if (slot.shmseg) {
+		xcb_shm_put_image(mConnection, window, mGc, slot.width, slot.height, rect.x, rect.y, rect.width, rect.height,
+						  rect.x, rect.y, mDepth, XCB_IMAGE_FORMAT_Z_PIXMAP, last ? 1 : 0, slot.shmseg, 0);
+		return;
+	}
+#endif
+	// PutImage sends no completion event
+	(void)last;
+
+	// PutImage has no row pitch and a size limit, send bands of whole rows
+	const uint32_t maxBytes =
+		static_cast<uint32_t>(std::min<size_t>(getXWinState().extensions.maxRequestBytes, UINT32_MAX)) - kPutImageHeaderBytes;
+	const uint32_t padBytes = mScanlinePad / 8;
+	const uint32_t rowBytes = (rect.width * mBitsPerPixel / 8 + padBytes - 1) / padBytes * padBytes;
+	const unsigned bandRows = std::max(1u, maxBytes / rowBytes);
+	const bool direct = mFormat == Format::Native && rect.width == slot.width;
+	for (unsigned y = 0; y < rect.height; y += bandRows) {
+		const unsigned rows = std::min(bandRows, rect.height - y);
+		const uint32_t* src = slot.pixels + static_cast<size_t>(rect.y + y) * slot.width + rect.x;
+		const uint8_t* data = reinterpret_cast<const uint8_t*>(src);
+		if (!direct) {
+			mScratch.resize((static_cast<size_t>(rows) * rowBytes + 3) / 4);
+			uint8_t* out = reinterpret_cast<uint8_t*>(mScratch.data());
+			for (unsigned row = 0; row < rows; ++row) {
+				convert_row(out + static_cast<size_t>(row) * rowBytes, src + static_cast<size_t>(row) * slot.width, rect.width);
+			}
+			data = out;
+		}
+		xcb_put_image(mConnection, XCB_IMAGE_FORMAT_Z_PIXMAP, window, mGc, rect.width, rows, rect.x, rect.y + y, 0,
+					  mDepth, rows * rowBytes, data);
+	}
+}
+
+auto Framebuffer::convert_row(uint8_t* dst, const uint32_t* src, unsigned count) const -> void {
+	switch (mFormat) {
+	case Format::Native:
+		memcpy(dst, src, count * sizeof(uint32_t));
+		break;
+	case Format::Premultiplied:
+		pixel::premultiply(reinterpret_cast<uint32_t*>(dst), src, count);
+		break;
+	case Format::Rgb565:
+		pixel::convertToRgb565(reinterpret_cast<uint16_t*>(dst), src, count);
+		break;
+	case Format::X2Rgb10:
+		pixel::convertToX2Rgb10(reinterpret_cast<uint32_t*>(dst), src, count);
+		break;
+	default:
+		break;
+	}
+}
+
+auto Framebuffer::allocate(Slot& slot, unsigned width, unsigned height) -> bool {
+	free_slot(slot);
+	const size_t bytes = static_cast<size_t>(width) * height * sizeof(uint32_t);
+
+#if XWIN_XCB_SHM
+	if (mUseShm) {
+		const int shmid = shmget(IPC_PRIVATE, bytes, IPC_CREAT | 0600);
+		void* address = shmid >= 0 ? shmat(shmid, nullptr, 0) : reinterpret_cast<void*>(-1);
+		bool attached = false;
+		if (address != reinterpret_cast<void*>(-1)) {
+			const uint32_t shmseg = xcb_generate_id(mConnection);
+			if (sShmAttach == ShmAttach::Works) {
+				xcb_shm_attach(mConnection, shmseg, shmid, 0);
+				attached = true;
+			} else {
+				// Remote connections cannot share memory, find out once and fall back for good
+				const xcb_void_cookie_t cookie = xcb_shm_attach_checked(mConnection, shmseg, shmid, 0);
+				xcb_generic_error_t* error = nullptr;
+				{
+					XWIN_ROUND_TRIP_SCOPE();
+					error = xcb_request_check(mConnection, cookie);
+				}
+				attached = !error;
+				free(error);
+				sShmAttach = attached ? ShmAttach::Works : ShmAttach::Fails;
+			}
+			if (attached) {
+				slot.pixels = static_cast<uint32_t*>(address);
+				slot.shmseg = shmseg;
+			} else {
+				shmdt(address);
+			}
+		}
+		if (shmid >= 0) {
+			// Linux lets the server attach a segment already marked for removal, it is then
+			// freed as soon as both sides detach, even if we crash
+			shmctl(shmid, IPC_RMID, nullptr);
+		}
+		if (!attached) {
+			mUseShm = false;
+		}
+	}
+#endif
+
+	if (!slot.pixels) {
+		slot.pixels = static_cast<uint32_t*>(calloc(bytes, 1));
+		if (!slot.pixels) {
+			return false;
+		}
+	}
+	slot.width = width;
+	slot.height = height;
+	slot.busy = false;
+	slot.stale.clear();
+	return true;
+}
+
+auto Framebuffer::free_slot(Slot& slot) -> void {
+	if (!slot.pixels) {
+		return;
+	}
+#if XWIN_XCB_SHM
+	if (slot.shmseg) {
+		// Requests already sent are processed before the detach, and the server
+		// keeps its own mapping until then
+		xcb_shm_detach(mConnection, slot.shmseg);
+		shmdt(slot.pixels);
+	} else {
+		free(slot.pixels);
+	}
+#else
+	free(slot.pixels);
+#endif
+	slot = Slot();
+}
+
+auto Framebuffer::complete(uint32_t shmseg) -> void {
+	for (Slot& slot : mSlots) {
+		if (slot.shmseg == shmseg) {
+			slot.busy = false;
+		}
+	}
+}
+
+} // namespace xwin
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "../Common/WindowDesc.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <xcb/xcb.h>
+
+namespace xwin {
+
+struct Window;
+
+/**
+ * Double buffered CPU render target for a window. Frames are handed to the
+ * server through MIT-SHM segments when it shares memory with us, otherwise
+ * they are streamed with PutImage in chunks that fit the request size limit.
+ * Visuals other than 24 bit are converted with the kernels in PixelConvert.h.
+ */
+class Framebuffer {
+public:
+	struct Buffer {
+		// 32 bit BGRA pixels (0xAARRGGBB) with straight alpha, null if no buffer is free
+		uint32_t* pixels = nullptr;
+		unsigned width   = 0;
+		unsigned height  = 0;
+		// Row pitch in pixels
+		unsigned stride  = 0;
+	};
+	Framebuffer() = default;
+	~Framebuffer();
+	Framebuffer(const Framebuffer&) = delete;
+	Framebuffer& operator=(const Framebuffer&) = delete;
+	// Returns a back buffer at the window's current size that already holds the last presented
+	// frame, so only changed regions need redrawing. The contents are cleared after a resize.
+	// pixels is null while the server is still reading both buffers, try again next frame.
+	[[nodiscard]] auto lock() -> Buffer;
+	// Shows the given regions of the locked buffer, no regions presents all of it
+	auto present(const Rect* rects, size_t count) -> void;
+	auto present(const std::vector<Rect>& rects) -> void { present(rects.data(), rects.size()); }
+	[[nodiscard]] auto is_shared_memory() const -> bool { return mUseShm; }
+protected:
+	// How pixels are converted for the root visual
+	enum class Format {
+		Unsupported,
+		// 24 bit BGRX, sent as is and through MIT-SHM
+		Native,
+		// 32 bit ARGB visuals expect premultiplied alpha
+		Premultiplied,
+		Rgb565,
+		X2Rgb10
+	};
+	struct Slot {
+		uint32_t* pixels = nullptr;
+		unsigned width   = 0;
+		unsigned height  = 0;
+		// MIT-SHM segment, 0 for heap buffers
+		uint32_t shmseg  = 0;
+		// The server has not finished reading this buffer yet
+		bool busy        = false;
+		// Regions presented from the other buffer since this one was last locked
+		std::vector<Rect> stale;
+	};
+	auto init(Window* window) -> void;
+	auto release() -> void;
+	auto allocate(Slot& slot, unsigned width, unsigned height) -> bool;
+	auto free_slot(Slot& slot) -> void;
+	auto put(const Slot& slot, const Rect& rect, bool last) -> void;
+	auto convert_row(uint8_t* dst, const uint32_t* src, unsigned count) const -> void;
+	// MIT-SHM completion for a segment, called by the EventQueue
+	auto complete(uint32_t shmseg) -> void;
+	Window* mWindow = nullptr;
+	xcb_connection_t* mConnection = nullptr;
+	xcb_gcontext_t mGc = 0;
+	uint8_t mDepth = 0;
+	Format mFormat = Format::Unsupported;
+	// Bits per pixel and row alignment PutImage expects for mFormat
+	uint8_t mBitsPerPixel = 0;
+	uint8_t mScanlinePad = 0;
+	bool mUseShm = false;
+	Slot mSlots[2];
+	int mLocked = -1;
+	int mLastPresented = 1;
+	// Packs and converts rows for PutImage, which has no row pitch
+	std::vector<uint32_t> mScratch;
+	friend struct Window;
+	friend class EventQueue;
+};
+
+} // namespace xwin
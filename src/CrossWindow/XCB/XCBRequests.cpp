@@ -0,0 +1,101 @@
+#include "XCBRequests.h"
+#include "../Common/RoundTrips.h"
+
+#include <stdlib.h>
+#include <xcb/xcbext.h>
+
+namespace xwin {
+
+auto Requests::init(xcb_connection_t* connection) -> void {
+	mConnection = connection;
+}
+
+auto Requests::release() -> void {
+	// Checked requests without a reply keep their error until discarded too
+	for (const Pending& pending : mPending) {
+		xcb_discard_reply(mConnection, pending.sequence);
+	}
+	mPending.clear();
+	mConnection = nullptr;
+}
+
+auto Requests::on_reply(unsigned int sequence, ReplyHandler handler) -> void {
+	mPending.push_back({sequence, false, nullptr, std::move(handler), nullptr});
+}
+
+auto Requests::on_error(xcb_void_cookie_t cookie, const char* request, FailureHandler failed) -> void {
+	mPending.push_back({cookie.sequence, true, request, nullptr, std::move(failed)});
+}
+
+auto Requests::poll() -> bool {
+	bool resolved = false;
+	while (!mPending.empty()) {
+		// Replies come back in request order, nothing after an unanswered one is ready either
+		void* reply = nullptr;
+		xcb_generic_error_t* error = nullptr;
+		if (!xcb_poll_for_reply(mConnection, mPending.front().sequence, &reply, &error)) {
+			break;
+		}
+		// Handlers may register new requests, take this one off first
+		Pending pending = std::move(mPending.front());
+		mPending.pop_front();
+		resolved = true;
+		resolve(pending, reply, error);
+	}
+	return resolved;
+}
+
+auto Requests::wait() -> void {
+	while (!mPending.empty()) {
+		if (poll()) {
+			continue;
+		}
+		// Nothing more has arrived, block on the oldest request alone
+		Pending pending = std::move(mPending.front());
+		mPending.pop_front();
+		void* reply = nullptr;
+		xcb_generic_error_t* error = nullptr;
+		{
+			XWIN_ROUND_TRIP_SCOPE();
+			if (pending.voidRequest) {
+				error = xcb_request_check(mConnection, {pending.sequence});
+			} else {
+				reply = xcb_wait_for_reply(mConnection, pending.sequence, &error);
+			}
+		}
+		resolve(pending, reply, error);
+	}
+}
+
+auto Requests::resolve(Pending& pending, void* reply, xcb_generic_error_t* error) -> void {
+	if (pending.replied) {
+		pending.replied(reply, error);
+	}
+	// Requests with a reply handle their own errors
+	if (error && pending.voidRequest) {
+		if (pending.failed) {
+			pending.failed(*error);
+		}
+		if (mErrorHandler) {
+			mErrorHandler(*error, pending.request);
+		}
+	}
+	free(reply);
+	free(error);
+}
+
+auto Requests::fence() -> void {
+	if (mPending.empty() || !mPending.back().voidRequest) {
+		return;
+	}
+	const xcb_get_input_focus_cookie_t cookie = xcb_get_input_focus(mConnection);
+	on_reply(cookie.sequence, nullptr);
+}
+
+auto Requests::report(const xcb_generic_error_t* error) -> void {
+	if (mErrorHandler) {
+		mErrorHandler(*error, nullptr);
+	}
+}
+
+} // namespace xwin
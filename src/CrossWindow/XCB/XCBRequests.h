@@ -0,0 +1,71 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <xcb/xcb.h>
+
+namespace xwin {
+
+/**
+ * Replies and errors of requests in flight, resolved during
+ * EventQueue::update() as the server answers instead of blocking the
+ * caller, so backend code stays pipelined and still hears about failures.
+ * Handlers run in request order.
+ */
+class Requests {
+public:
+	// reply is null when error is set and the other way around. Both are freed once the handler returns
+	using ReplyHandler = std::function<void(void* reply, xcb_generic_error_t* error)>;
+	using FailureHandler = std::function<void(const xcb_generic_error_t& error)>;
+	// request names the failed request, null for errors of requests nobody registered
+	using ErrorHandler = std::function<void(const xcb_generic_error_t& error, const char* request)>;
+
+	Requests() = default;
+	// Standalone, for work that has to finish before there is an EventQueue
+	explicit Requests(xcb_connection_t* connection) : mConnection(connection) {}
+
+	// Runs handler once the reply to the request with this sequence number, or its error, arrives
+	auto on_reply(unsigned int sequence, ReplyHandler handler) -> void;
+	// Typed wrapper, for example on_reply<xcb_get_property_reply_t>(cookie, ...)
+	template <typename Reply, typename Cookie>
+	auto on_reply(Cookie cookie, std::function<void(Reply* reply, xcb_generic_error_t* error)> handler) -> void {
+		on_reply(cookie.sequence, [handler](void* reply, xcb_generic_error_t* error) { handler(static_cast<Reply*>(reply), error); });
+	}
+	// Watches a request sent with its _checked variant. If it fails, failed runs when given, then the error handler
+	auto on_error(xcb_void_cookie_t cookie, const char* request, FailureHandler failed = nullptr) -> void;
+	// Receives every failure, none by default
+	auto set_error_handler(ErrorHandler handler) -> void { mErrorHandler = std::move(handler); }
+	// Blocks until every request resolved, including those handlers register meanwhile
+	auto wait() -> void;
+protected:
+	struct Pending {
+		unsigned int sequence;
+		// Checked requests without a reply only resolve once a later reply arrives
+		bool voidRequest;
+		const char* request;
+		ReplyHandler replied;
+		FailureHandler failed;
+	};
+
+	auto init(xcb_connection_t* connection) -> void;
+	// Drops every pending request without running its handler
+	auto release() -> void;
+	// Runs the handlers of every reply and error that has arrived, returns whether any had
+	auto poll() -> bool;
+	// Follows trailing checked requests with a cheap request that has a reply, so
+	// their success is known without a blocking sync
+	auto fence() -> void;
+	// An error of an unchecked request, found in the event stream
+	auto report(const xcb_generic_error_t* error) -> void;
+	// Runs the handlers of a request taken off the queue and frees what it got
+	auto resolve(Pending& pending, void* reply, xcb_generic_error_t* error) -> void;
+	// A reply is outstanding, xcb_wait_for_event would not wake for it
+	[[nodiscard]] auto waiting() const -> bool { return !mPending.empty(); }
+
+	xcb_connection_t* mConnection = nullptr;
+	std::deque<Pending> mPending;
+	ErrorHandler mErrorHandler;
+	friend class EventQueue;
+};
+
+} // namespace xwin
@@ -1,4 +1,21 @@
 #include "XCBWindow.h"
+#include "../Common/Counters.h"
+#include "../Common/PixelConvert.h"
+#include "XCBCursors.h"
+#include "XCBDisplays.h"
+
+#include <algorithm>
+#include <vector>
+
+#if XWIN_XCB_PRESENT
+#include <xcb/present.h>
+#endif
+#if XWIN_XCB_SYNC
+#include <xcb/sync.h>
+#endif
+#if XWIN_XCB_XFIXES
+#include <xcb/xfixes.h>
+#endif
 
 namespace xwin {
 
@@ -13,8 +30,10 @@ auto Window::create(const WindowDesc& desc, EventQueue& eventQueue, void* parent
 	mConnection = xwinState.connection;
 	mScreen = xwinState.screen;
 
+	mEventQueue = &eventQueue;
+
 	mXcbWindowId = xcb_generate_id(mConnection);
-	const auto parent_window_id = (xcb_window_t)(uintptr_t)(parentWindow);
+	const auto parent_window_id = parentWindow ? (xcb_window_t)(uintptr_t)(parentWindow) : mScreen->root;
 
 	uint32_t mask = XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK;
 	uint32_t value_list[2] = {
@@ -22,14 +41,69 @@ auto Window::create(const WindowDesc& desc, EventQueue& eventQueue, void* parent
 		XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_BUTTON_PRESS |
 			XCB_EVENT_MASK_BUTTON_RELEASE | XCB_EVENT_MASK_POINTER_MOTION |
 			XCB_EVENT_MASK_ENTER_WINDOW | XCB_EVENT_MASK_LEAVE_WINDOW |
-			XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE};
+			XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE |
+			XCB_EVENT_MASK_STRUCTURE_NOTIFY};
 
-	xcb_create_window(mConnection, XCB_COPY_FROM_PARENT, mXcbWindowId, parent_window_id,
-					  desc.x, desc.y, desc.width, desc.height, 0,
-					  XCB_WINDOW_CLASS_INPUT_OUTPUT, mScreen->root_visual, mask,
-					  value_list);
+	const xcb_void_cookie_t created = xcb_create_window_checked(mConnection, XCB_COPY_FROM_PARENT, mXcbWindowId, parent_window_id,
+									  desc.x, desc.y, desc.width, desc.height, 0,
+									  XCB_WINDOW_CLASS_INPUT_OUTPUT, mScreen->root_visual, mask,
+									  value_list);
 
-	xcb_map_window(mConnection, mXcbWindowId);
+	mHandle = mEventQueue->addWindow(mXcbWindowId, this);
+	const Rect rect(static_cast<int>(desc.x), static_cast<int>(desc.y), desc.width, desc.height);
+	mEventQueue->mWindows.rect(mHandle) = rect;
+	// Creation is not waited on, a window the server refused turns invalid once update() hears of it
+	const xcb_window_t id = mXcbWindowId;
+	mEventQueue->mRequests.on_error(created, "CreateWindow", [queue = mEventQueue, id](const xcb_generic_error_t&) {
+		Window* window = queue->findWindow(id);
+		if (window) {
+			queue->removeWindow(id);
+			window->mEventQueue = nullptr;
+			window->mHandle = WindowHandle();
+			window->mXcbWindowId = 0;
+		}
+	});
+	if (parent_window_id != mScreen->root) {
+		mEventQueue->mWindows.flags(mHandle) |= WindowPool::Reparented;
+	}
+	{
+		CurrentDisplays displays;
+		const DisplayDesc* display = displays->find(rect);
+		mDpiScale = display ? display->scale : 1.0f;
+	}
+
+	const AtomCache& atoms = xwinState.atoms;
+#if XWIN_XCB_SYNC
+	// The window manager waits on this counter before each new size during an interactive resize
+	if (xwinState.extensions.sync) {
+		mSyncCounter = xcb_generate_id(mConnection);
+		const xcb_sync_int64_t zero = {0, 0};
+		xcb_sync_create_counter(mConnection, mSyncCounter, zero);
+		xcb_change_property(mConnection, XCB_PROP_MODE_REPLACE, mXcbWindowId, atoms[AtomId::NET_WM_SYNC_REQUEST_COUNTER],
+							XCB_ATOM_CARDINAL, 32, 1, &mSyncCounter);
+	}
+#endif
+
+	// Ask the window manager to send WM_DELETE_WINDOW instead of killing the
+	// connection, to ping us to check we are still responsive, and to sync resizes with our frames
+	const xcb_atom_t protocols[] = {atoms[AtomId::WM_DELETE_WINDOW], atoms[AtomId::NET_WM_PING],
+									atoms[AtomId::NET_WM_SYNC_REQUEST]};
+	xcb_change_property(mConnection, XCB_PROP_MODE_REPLACE, mXcbWindowId, atoms[AtomId::WM_PROTOCOLS],
+						XCB_ATOM_ATOM, 32, mSyncCounter ? 3 : 2, protocols);
+
+	// Accept files dragged from other applications, up to XDND version 5
+	const xcb_atom_t xdndVersion = 5;
+	xcb_change_property(mConnection, XCB_PROP_MODE_REPLACE, mXcbWindowId, atoms[AtomId::XDND_AWARE], XCB_ATOM_ATOM, 32,
+						1, &xdndVersion);
+
+#if XWIN_XCB_PRESENT
+	if (xwinState.extensions.presentOpcode) {
+		mPresentEventId = xcb_generate_id(mConnection);
+		xcb_present_select_input(mConnection, mPresentEventId, mXcbWindowId, XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY);
+	}
+#endif
+
+	check(xcb_map_window_checked(mConnection, mXcbWindowId), "MapWindow");
 
 	const unsigned coords[] = {static_cast<unsigned>(desc.x), static_cast<unsigned>(desc.y)};
 	xcb_configure_window(mConnection, mXcbWindowId, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y, coords);
@@ -40,34 +114,164 @@ auto Window::create(const WindowDesc& desc, EventQueue& eventQueue, void* parent
 
 	xcb_flush(mConnection);
 
+	count(Counter::Flushes);
+
 	return true;
 }
 
 void Window::destroy() {
-	xcb_destroy_window(mConnection, mXcbWindowId);
+	if (mEventQueue) {
+		mEventQueue->removeWindow(mXcbWindowId);
+		mEventQueue = nullptr;
+		mHandle = WindowHandle();
+	}
+	mFramebuffer.release();
+#if XWIN_XCB_SYNC
+	if (mSyncCounter) {
+		xcb_sync_destroy_counter(mConnection, mSyncCounter);
+		mSyncCounter = 0;
+	}
+#endif
+	if (mXcbWindowId) {
+		xcb_destroy_window(mConnection, mXcbWindowId);
+		mXcbWindowId = 0;
+	}
+}
+
+auto Window::get_current_display_position() const -> UVec2 {
+	CurrentDisplays displays;
+	const DisplayDesc* display = displays->find(rect());
+	if (!display) {
+		return UVec2();
+	}
+	// The root window starts at 0, 0, only a misreporting driver places a display left of or above it
+	return UVec2(static_cast<unsigned>(std::max(display->x, 0)), static_cast<unsigned>(std::max(display->y, 0)));
+}
+
+auto Window::get_current_display_size() const -> UVec2 {
+	CurrentDisplays displays;
+	const DisplayDesc* display = displays->find(rect());
+	return display ? UVec2(display->width, display->height) : UVec2(mScreen->width_in_pixels, mScreen->height_in_pixels);
+}
+
+auto Window::get_framebuffer() -> Framebuffer& {
+	if (!mFramebuffer.mWindow) {
+		mFramebuffer.init(this);
+	}
+	return mFramebuffer;
 }
 
 auto Window::get_size(unsigned* width, unsigned* height) -> void {
-	// Get the window size
-	xcb_get_geometry_cookie_t geometry_cookie = xcb_get_geometry(mConnection, mXcbWindowId);
-	xcb_get_geometry_reply_t* geometry_reply = xcb_get_geometry_reply(mConnection, geometry_cookie, nullptr);
-	if (geometry_reply) {
-		*width = geometry_reply->width;
-		*height = geometry_reply->height;
-		free(geometry_reply);
+	// ConfigureNotify keeps the size current, no need to ask the server
+	const Rect current = rect();
+	*width = current.width;
+	*height = current.height;
+}
+
+auto Window::request_paint() -> void {
+	// Destroyed, or refused by the server
+	if (!mEventQueue || !mXcbWindowId) {
+		return;
+	}
+	uint8_t& flags = mEventQueue->mWindows.flags(mHandle);
+	if (flags & WindowPool::PaintRequested) {
+		return;
+	}
+	flags |= WindowPool::PaintRequested;
+#if XWIN_XCB_PRESENT
+	if (mPresentEventId) {
+		// Divisor 1 and remainder 0 match the first vblank after the current one
+		xcb_present_notify_msc(mConnection, mXcbWindowId, ++mPaintSerial, 0, 1, 0);
+		return;
+	}
+#endif
+	mEventQueue->mPaintRequests.push_back(this);
+}
+
+auto Window::rect() const -> Rect {
+	return mEventQueue && mEventQueue->mWindows.contains(mHandle) ? mEventQueue->mWindows.rect(mHandle) : Rect();
+}
+
+auto Window::set_cursor(CursorShape shape) -> void {
+	mCursor = shape_cursor(shape);
+	update_cursor();
+}
+
+auto Window::set_cursor_image(const uint32_t* rgba, unsigned width, unsigned height, unsigned hotX, unsigned hotY) -> bool {
+	const xcb_cursor_t cursor = image_cursor(rgba, width, height, hotX, hotY);
+	if (cursor == XCB_CURSOR_NONE) {
+		return false;
+	}
+	mCursor = cursor;
+	update_cursor();
+	return true;
+}
+
+auto Window::set_cursor_visible(bool visible) -> void {
+	if (visible != mCursorHidden) {
+		return;
+	}
+	mCursorHidden = !visible;
+#if XWIN_XCB_XFIXES
+	// The server hides it while the pointer is over the window, whatever cursor is set
+	if (getXWinState().extensions.xfixes) {
+		if (mCursorHidden) {
+			xcb_xfixes_hide_cursor(mConnection, mXcbWindowId);
+		} else {
+			xcb_xfixes_show_cursor(mConnection, mXcbWindowId);
+		}
+		return;
+	}
+#endif
+	update_cursor();
+}
+
+auto Window::update_cursor() -> void {
+	bool blank = mCursorHidden;
+#if XWIN_XCB_XFIXES
+	blank = blank && !getXWinState().extensions.xfixes;
+#endif
+	const xcb_cursor_t cursor = blank ? blank_cursor() : mCursor;
+	if (cursor == mCursorShown) {
+		return;
 	}
+	// Goes out with the next flush, at the latest when the EventQueue next waits. Unchecked, so a
+	// switch is this one request, its rare errors still reach the error handler through the event stream
+	xcb_change_window_attributes(mConnection, mXcbWindowId, XCB_CW_CURSOR, &cursor);
+	mCursorShown = cursor;
+}
+
+auto Window::set_icon(const uint32_t* rgba, unsigned width, unsigned height) -> void {
+	// _NET_WM_ICON is the size followed by straight alpha ARGB cardinals
+	const size_t count = static_cast<size_t>(width) * height;
+	std::vector<uint32_t> icon(2 + count);
+	icon[0] = width;
+	icon[1] = height;
+	pixel::swapRedBlue(icon.data() + 2, rgba, count);
+	const AtomCache& atoms = getXWinState().atoms;
+	check(xcb_change_property_checked(mConnection, XCB_PROP_MODE_REPLACE, mXcbWindowId, atoms[AtomId::NET_WM_ICON],
+									  XCB_ATOM_CARDINAL, 32, static_cast<uint32_t>(icon.size()), icon.data()),
+		  "ChangeProperty");
 }
 
 auto Window::set_position(unsigned x, unsigned y) -> void {
 	// Set the window position
 	uint32_t coords[] = {x, y};
-	xcb_configure_window(mConnection, mXcbWindowId, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y, coords);
+	check(xcb_configure_window_checked(mConnection, mXcbWindowId, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y, coords),
+		  "ConfigureWindow");
 }
 
 auto Window::set_size(unsigned width, unsigned height) -> void {
 	// Set the window size
 	uint32_t dims[] = {width, height};
-	xcb_configure_window(mConnection, mXcbWindowId, XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, dims);
+	check(xcb_configure_window_checked(mConnection, mXcbWindowId, XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, dims),
+		  "ConfigureWindow");
+}
+
+auto Window::check(xcb_void_cookie_t cookie, const char* request) -> void {
+	if (mEventQueue) {
+		mEventQueue->mRequests.on_error(cookie, request);
+	}
 }
 
 } // namespace xwin
\ No newline at end of file
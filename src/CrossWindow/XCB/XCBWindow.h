@@ -1,8 +1,12 @@
 #pragma once
 
+#include "../Common/CursorDesc.h"
 #include "../Common/EventQueue.h"
+#include "../Common/DamageRegion.h"
 #include "../Common/Init.h"
 #include "../Common/WindowDesc.h"
+#include "../Common/WindowHandle.h"
+#include "XCBFramebuffer.h"
 
 #include <any>
 #include <xcb/xcb.h>
@@ -12,21 +16,77 @@ namespace xwin {
 struct Window {
 	Window() = default;
 	~Window();
-	[[nodiscard]] auto get_client_data() -> std::any { return client_data; }
+	[[nodiscard]] auto get_client_data() const -> const std::any& { return client_data; }
+	// Application object behind the window, a single load from an event handler. Not owned, unlike client data
+	template <typename T>
+	[[nodiscard]] auto get_user() const -> T* { return static_cast<T*>(mUserData); }
 	[[nodiscard]] auto get_native_handle() -> void* { return (void*)(mXcbWindowId); }
 	[[nodiscard]] auto create(const WindowDesc& desc, EventQueue& eventQueue, void* parentWindow) -> bool;
 	[[nodiscard]] auto is_valid() const -> bool { return bool(mXcbWindowId); }
+	// Names the window in events, resolved with EventQueue::getWindow. Null before create() and after destroy()
+	[[nodiscard]] auto get_handle() const -> WindowHandle { return mHandle; }
 	auto destroy() -> void;
+	// CPU render target sized to the window, created on first use
+	[[nodiscard]] auto get_framebuffer() -> Framebuffer&;
+	// Display scale (DPI / 96) of the output showing most of the window, DPI events report changes
+	[[nodiscard]] auto get_dpi_scale() const -> float { return mDpiScale; }
+	// Top left corner and size of the display showing most of the window, from the cached display snapshot
+	[[nodiscard]] auto get_current_display_position() const -> UVec2;
+	[[nodiscard]] auto get_current_display_size() const -> UVec2;
+	// Size as of the last ConfigureNotify, answered without a round trip
 	auto get_size(unsigned* width, unsigned* height) -> void;
-	auto set_client_data(std::any data) -> void { client_data = data; }
+	// Asks for one Paint event timed to the next vertical blank when the Present extension is
+	// available, or on the next EventQueue::update() otherwise. Call again after each Paint to keep drawing.
+	auto request_paint() -> void;
+	auto set_client_data(std::any data) -> void { client_data = std::move(data); }
+	template <typename T>
+	auto set_user(T* data) -> void { mUserData = data; }
+	// Shows a standard pointer shape over the window. Cursors are cached, and switching to the one
+	// already shown sends nothing, so this is cheap to call on every hover change
+	auto set_cursor(CursorShape shape) -> void;
+	// Shows a cursor made from RGBA pixels in memory order, false if the server has no ARGB cursors
+	auto set_cursor_image(const uint32_t* rgba, unsigned width, unsigned height, unsigned hotX, unsigned hotY) -> bool;
+	auto set_cursor_visible(bool visible) -> void;
+	// Sets the icon shown by the window manager from RGBA pixels in memory order, as image decoders produce them
+	auto set_icon(const uint32_t* rgba, unsigned width, unsigned height) -> void;
 	auto set_position(unsigned x, unsigned y) -> void;
 	auto set_size(unsigned width, unsigned height) -> void;
 protected:
+	auto update_cursor() -> void;
+	// Geometry as of the last ConfigureNotify, kept in the EventQueue's WindowPool. Empty unless created
+	[[nodiscard]] auto rect() const -> Rect;
+	// Reports a failure of a request sent with its _checked variant to the EventQueue's error handler
+	auto check(xcb_void_cookie_t cookie, const char* request) -> void;
+
 	xcb_connection_t* mConnection = nullptr;
 	xcb_screen_t* mScreen = nullptr;
+	EventQueue* mEventQueue = nullptr;
+	WindowHandle mHandle;
 	unsigned mXcbWindowId = 0;
 	unsigned mDisplay = 0;
 	std::any client_data;
+	void* mUserData = nullptr;
+	float mDpiScale = 1.0f;
+	// Present vblank notifications driving Paint events
+	uint32_t mPresentEventId = 0;
+	uint32_t mPaintSerial = 0;
+	uint64_t mLastMsc = 0;
+	uint64_t mLastUst = 0;
+	uint64_t mFrameInterval = 0;
+	// _NET_WM_SYNC_REQUEST counter, set to the value the window manager last sent
+	// once a frame at the size it configured has been drawn. 0 without SYNC
+	uint32_t mSyncCounter = 0;
+	uint64_t mSyncValue = 0;
+	bool mSyncRequested = false;
+	// Cursor asked for and the one last set on the window, switches to the same cursor are elided
+	xcb_cursor_t mCursor = XCB_CURSOR_NONE;
+	xcb_cursor_t mCursorShown = XCB_CURSOR_NONE;
+	bool mCursorHidden = false;
+	// Expose rects collected until the last of a burst arrives
+	DamageRegion mDamage;
+	Framebuffer mFramebuffer;
+	friend class EventQueue;
+	friend class Framebuffer;
 };
 
 } // namespace xwin
@@ -0,0 +1,32 @@
+#include "../Common/DisplayScale.h"
+#include "../Common/Displays.h"
+#include "../Common/Init.h"
+
+#include <string.h>
+
+namespace xwin {
+
+std::vector<DisplayDesc> enumerateDisplays() {
+	const XWinState& xwinState = getXWinState();
+	if (!xwinState.display) {
+		return {};
+	}
+
+	// Without RandR the core screen stands for every monitor. The Display keeps copies of the
+	// screen and the resource database from when it was opened, so nothing reaches the server
+	const Screen* screen = DefaultScreenOfDisplay(xwinState.display);
+	DisplayDesc display;
+	display.width = static_cast<unsigned>(WidthOfScreen(screen));
+	display.height = static_cast<unsigned>(HeightOfScreen(screen));
+	display.widthMillimeters = static_cast<unsigned>(WidthMMOfScreen(screen));
+	display.heightMillimeters = static_cast<unsigned>(HeightMMOfScreen(screen));
+	display.primary = true;
+
+	// Xft.dpi is the user's explicit choice
+	const char* resources = XResourceManagerString(xwinState.display);
+	const float xftDpi = resources ? parseXftDpi(resources, strlen(resources)) : 0.0f;
+	display.scale = xftDpi > 0.0f ? xftDpi / 96.0f : physicalScale(display);
+	return {display};
+}
+
+} // namespace xwin
@@ -1,61 +1,161 @@
 #include "XLibEventQueue.h"
+#include "../Common/Counters.h"
+#include "../Common/RoundTrips.h"
+#include "../Common/Trace.h"
 #include "../Common/Window.h"
 
 namespace xwin
 {
 void EventQueue::update()
 {
+	// Whatever the application did since the last update is one frame
+	finishRoundTripFrame();
+	UpdateTimer timer;
+	XWIN_TRACE_SCOPE("update");
+	Display* display = getXWinState().display;
 	XEvent event;
 
-	while (XPending(demo->display) > 0)
+	// Take everything one read brings in as a batch, only going back to the
+	// socket once it is drained. XEventsQueued does not flush by itself
+	XFlush(display);
+	count(Counter::Flushes);
+	for (;;)
 	{
-		XNextEvent(demo->display, &event);
-		pushEvent(event, mParent);
+		count(Counter::SocketReads);
+		int pending = 0;
+		{
+			XWIN_TRACE_SCOPE("read");
+			pending = XEventsQueued(display, QueuedAfterReading);
+		}
+		if (!pending)
+		{
+			break;
+		}
+		for (; pending > 0; --pending)
+		{
+			XNextEvent(display, &event);
+			count(Counter::EventsRead);
+			Window* window = findWindow(event.xany.window);
+			if (window)
+			{
+				XWIN_TRACE_SCOPE("decode");
+				pushEvent(&event, window);
+			}
+		}
 	}
 }
 
+const Event& EventQueue::front()
+{
+	return mQueue.front();
+}
+
+void EventQueue::pop()
+{
+	XWIN_TRACE_SCOPE("deliver");
+	XWIN_TRACE_FLOW_END(mQueue.frontFlow());
+	mQueue.pop();
+}
+
+bool EventQueue::empty()
+{
+	return mQueue.empty();
+}
+
+void EventQueue::setCapacity(size_t capacity, OverflowPolicy policy)
+{
+	mQueue.setCapacity(capacity, policy);
+}
+
+const EventBufferStats& EventQueue::getOverflowStats() const
+{
+	return mQueue.stats();
+}
+
+WindowHandle EventQueue::addWindow(::Window id, Window* window)
+{
+	return mWindows.insert(window, static_cast<uint32_t>(id));
+}
+
+void EventQueue::removeWindow(::Window id)
+{
+	const WindowHandle handle = mWindows.find(static_cast<uint32_t>(id));
+	Window* window = mWindows.get(handle);
+	if (!window)
+	{
+		return;
+	}
+	mQueue.invalidate(window);
+	mWindows.remove(handle);
+}
+
+Window* EventQueue::findWindow(::Window id) const
+{
+	return mWindows.get(mWindows.find(static_cast<uint32_t>(id)));
+}
+
+Window* EventQueue::getWindow(WindowHandle handle) const
+{
+	return mWindows.get(handle);
+}
+
+void EventQueue::enqueue(Event event)
+{
+	if (event.window)
+	{
+		event.handle = event.window->mHandle;
+	}
+	mQueue.push(event);
+}
+
 void EventQueue::pushEvent(const XEvent* event, Window* window)
 {
 	switch (event->type)
 	{
-		case ConfigureNotify: {
-			unsigned w, h;
-			window->get_size(&w, &h);
-			if ((w != event->xconfigure.width) || (h != event->xconfigure.height)) {
-				w = static_cast<unsigned>(event->xconfigure.width);
-				h = static_cast<unsigned>(event->xconfigure.height);
-				mQueue.emplace(ResizeData(w, h, true), window);
+		case ConfigureNotify:
+		{
+			// Moves arrive with the same size, compare against the last one seen
+			const unsigned w = static_cast<unsigned>(event->xconfigure.width);
+			const unsigned h = static_cast<unsigned>(event->xconfigure.height);
+			Rect& rect = mWindows.rect(window->mHandle);
+			if (w != rect.width || h != rect.height)
+			{
+				rect.width = w;
+				rect.height = h;
+				enqueue(Event(ResizeData(w, h, true), window));
 			}
 			break;
 		}
 		case ClientMessage:
 		{
-			mQueue.emplace(xwin::EventType::Close, window);
+			enqueue(Event(xwin::EventType::Close, window));
 			break;
 		}
 		case KeyPress:
 		{
 			Key d = Key::KeysMax;
-			switch (event->xkey.keycode)
+			switch (XLookupKeysym(const_cast<XKeyEvent*>(&event->xkey), 0))
 			{
-			case 0x9: // Escape
+			case XK_Escape:
 				d = Key::Escape;
 				break;
-			case XK_KP_Left: // left arrow key
+			case XK_Left:
 				d = Key::Left;
 				break;
-			case 0x72: // right arrow key
+			case XK_Right:
 				d = Key::Right;
 				break;
-			case 0x41: // space bar
+			case XK_space:
 				d = Key::Space;
 				break;
 			}
+			if (d != Key::KeysMax)
+			{
+				enqueue(Event(KeyboardData(d, ButtonState::Pressed, ModifierState()),
+							  window));
+			}
 			break;
-
-			mQueue.emplace(KeyboardData(d, ButtonState::Pressed, ModifierState()),
-						   window);
 		}
 	}
 }
-}
\ No newline at end of file
+}
@@ -1,8 +1,8 @@
 #pragma once
 
 #include "../Common/Event.h"
-
-#include <queue>
+#include "../Common/EventBuffer.h"
+#include "../Common/WindowPool.h"
 
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
@@ -14,9 +14,42 @@ struct Window;
 class EventQueue
 {
   public:
+    // Reads everything pending on the Display shared by all windows
+    void update();
+
+    const Event& front();
+
+    void pop();
+
+    bool empty();
+
+    // Caps the events held between updates, 0 (the default) for no limit.
+    // Keys, buttons and Close are always queued, see OverflowPolicy
+    void setCapacity(size_t capacity, OverflowPolicy policy);
+
+    // Lossy events dropped or coalesced because of the capacity
+    const EventBufferStats& getOverflowStats() const;
+
     void pushEvent(const XEvent* event, Window* window);
 
+    // The window an event's handle names, null once it was destroyed
+    Window* getWindow(WindowHandle handle) const;
+
+    friend struct Window;
+
   protected:
-    std::queue<Event> mQueue;
+    WindowHandle addWindow(::Window id, Window* window);
+
+    void removeWindow(::Window id);
+
+    Window* findWindow(::Window id) const;
+
+    // Queues an event stamped with the handle of its window
+    void enqueue(Event event);
+
+    EventBuffer mQueue;
+
+    // Windows created with this queue, X11 ids fit the pool's 32 bits
+    WindowPool mWindows;
 };
-}
\ No newline at end of file
+}
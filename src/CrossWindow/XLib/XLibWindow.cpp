@@ -7,6 +7,11 @@ Window::~Window() {
 }
 
 auto Window::destroy() -> void {
+	if (mEventQueue) {
+		mEventQueue->removeWindow(window_);
+		mEventQueue = nullptr;
+		mHandle = WindowHandle();
+	}
 	if (window_) {
 		XDestroyWindow(display_, window_);
 		window_ = 0;
@@ -14,8 +19,8 @@ auto Window::destroy() -> void {
 }
 
 auto Window::create(const WindowDesc& desc, EventQueue& eventQueue, void* parentWindow) -> bool {
-	XInitThreads();
-	display_  = XOpenDisplay(NULL);
+	// Every window shares the process's connection, opened once in main
+	display_  = getXWinState().display;
 	const auto screen   = DefaultScreen(display_);
 	const auto visual   = DefaultVisual(display_, screen);
 	const auto depth    = DefaultDepth(display_, screen);
@@ -31,20 +36,27 @@ auto Window::create(const WindowDesc& desc, EventQueue& eventQueue, void* parent
 					  desc.height, 0, depth, InputOutput, visual,
 					  CWBackPixel | CWBorderPixel | CWEventMask | CWColormap,
 					  &windowAttributes);
+	mEventQueue = &eventQueue;
+	mHandle = mEventQueue->addWindow(window_, this);
+	mEventQueue->mWindows.rect(mHandle) = Rect(0, 0, desc.width, desc.height);
 	if (parentWindow) {
-		XSetTransientForHint(display_, window, parent);
+		XSetTransientForHint(display_, window_, parent);
 	}
-	XSelectInput(display_, window, ExposureMask | KeyPressMask);
-	XMapWindow(display_, window);
+	XMapWindow(display_, window_);
 	XFlush(display_);
 	return true;
 }
 
 auto Window::get_size(unsigned* width, unsigned* height) -> void {
-	XLibWindow root;
-	int x, y;
-	unsigned border_width, depth;
-	XGetGeometry(display_, window_, &root, &x, &y, width, height, &border_width, &depth);
+	// ConfigureNotify keeps the size current, no need to ask the server
+	if (!mEventQueue) {
+		*width = 0;
+		*height = 0;
+		return;
+	}
+	const Rect& rect = mEventQueue->mWindows.rect(mHandle);
+	*width = rect.width;
+	*height = rect.height;
 }
 
 auto Window::set_position(unsigned x, unsigned y) -> void {
@@ -3,6 +3,7 @@
 #include "../Common/EventQueue.h"
 #include "../Common/Init.h"
 #include "../Common/WindowDesc.h"
+#include "../Common/WindowHandle.h"
 #include <any>
 #include <memory>
 #include <X11/Xlib.h>
@@ -14,20 +15,32 @@ namespace xwin {
 struct Window {
 	Window() = default;
 	~Window();
-	[[nodiscard]] auto get_client_data() -> std::any { return client_data; }
+	[[nodiscard]] auto get_client_data() const -> const std::any& { return client_data; }
+	// Application object behind the window, a single load from an event handler. Not owned, unlike client data
+	template <typename T>
+	[[nodiscard]] auto get_user() const -> T* { return static_cast<T*>(mUserData); }
 	[[nodiscard]] auto get_native_handle() -> void* { return (void*)(window_); }
+	// Names the window in events, resolved with EventQueue::getWindow
+	[[nodiscard]] auto get_handle() const -> WindowHandle { return mHandle; }
 	[[nodiscard]] auto create(const WindowDesc& desc, EventQueue& eventQueue, void* parentWindow) -> bool;
 	[[nodiscard]] auto is_valid() const -> bool { return bool(window_); }
 	auto destroy() -> void;
 	auto get_size(unsigned* width, unsigned* height) -> void;
-	auto set_client_data(std::any data) -> void { client_data = data; }
+	auto set_client_data(std::any data) -> void { client_data = std::move(data); }
+	template <typename T>
+	auto set_user(T* data) -> void { mUserData = data; }
 	auto set_position(unsigned x, unsigned y) -> void;
 	auto set_size(unsigned width, unsigned height) -> void;
 protected:
 	Window(Display* display, XLibWindow window) : display_(display), window_(window) {}
 	Display* display_  = 0;
 	XLibWindow window_ = 0;
+	EventQueue* mEventQueue = nullptr;
+	// Slot in the queue's pool, which keeps the last size ConfigureNotify reported
+	WindowHandle mHandle;
 	std::any client_data;
+	void* mUserData = nullptr;
+	friend class EventQueue;
 };
 
 } // namespace xwin